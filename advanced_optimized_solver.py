@@ -10,6 +10,7 @@ from collections import defaultdict
 import random
 import time
 from typing import List, Tuple, Dict, Optional
+from room_layout import column_skipped, room_positions
 
 class OptimizedSeatingAssigner:
     """Advanced seating assignment with multiple optimization strategies"""
@@ -32,6 +33,8 @@ class OptimizedSeatingAssigner:
         
         if exam_room_restrictions is None:
             exam_room_restrictions = {}
+        # Compile restrictions once so each check is a set lookup
+        exam_room_restrictions = {exam: set(rids) for exam, rids in exam_room_restrictions.items()}
             
         # Phase 1: Assign students to rooms (high-level optimization)
         room_assignments = self._assign_students_to_rooms_only(
@@ -159,11 +162,7 @@ class OptimizedSeatingAssigner:
         room_capacities = []
         
         for ki, (rid, rows, cols, skip_rows, skip_cols) in enumerate(rooms):
-            capacity = rows * cols
-            if skip_rows:
-                capacity //= 2
-            if skip_cols:
-                capacity //= 2
+            capacity = len(room_positions(rows, cols, skip_rows, skip_cols))
             room_capacities.append(capacity)
             
             for s, e in students:
@@ -222,7 +221,7 @@ class OptimizedSeatingAssigner:
             if skip_rows and r % 2 != 0:
                 continue
             for c in range(cols):
-                if skip_cols and c % 2 != 0:
+                if column_skipped(c, skip_cols):
                     continue
                 positions.append((r, c))
         
@@ -292,7 +291,7 @@ class OptimizedSeatingAssigner:
                 if skip_rows and r % 2 != 0:
                     continue
                 for c in range(cols):
-                    if skip_cols and c % 2 != 0:
+                    if column_skipped(c, skip_cols):
                         continue
                     positions.append((r, c))
             room_info[rid] = positions
@@ -422,7 +421,7 @@ class OptimizedSeatingAssigner:
                 if skip_rows and r % 2 != 0:
                     continue
                 for c in range(cols):
-                    if skip_cols and c % 2 != 0:
+                    if column_skipped(c, skip_cols):
                         continue
                     seat_to_node[(rid, r, c)] = node_counter
                     G.add_node(node_counter, room=rid, row=r, col=c)
@@ -431,7 +430,7 @@ class OptimizedSeatingAssigner:
         # Add edges (conflicts between adjacent seats)
         for rid, rows, cols, skip_rows, skip_cols in rooms:
             positions = [(r, c) for r in range(rows) for c in range(cols)
-                        if not (skip_rows and r % 2 != 0) and not (skip_cols and c % 2 != 0)]
+                        if not (skip_rows and r % 2 != 0) and not column_skipped(c, skip_cols)]
             
             for r1, c1 in positions:
                 for r2, c2 in positions:
@@ -1,6 +1,7 @@
 from ortools.sat.python import cp_model
 from models import AssignmentWithStudentOut
 from simple_greedy_solver import build_assignment_with_student
+import room_layout
 
 def assign_students_to_rooms(students, rooms, exam_room_restrictions=None, timeout_seconds=300):
     """
@@ -17,14 +18,7 @@ def assign_students_to_rooms(students, rooms, exam_room_restrictions=None, timeo
     room_positions = {}
     total_capacity = 0
     for ki, (rid, R, C, skip_rows, skip_cols) in enumerate(rooms):
-        positions = []
-        for r in range(R):
-            if skip_rows and r % 2 != 0:
-                continue
-            for c in range(C):
-                if isinstance(skip_cols, int) and skip_cols > 0 and c % skip_cols == 0:
-                    continue
-                positions.append((r, c))
+        positions = room_layout.room_positions(R, C, skip_rows, skip_cols)
         room_positions[ki] = positions
         total_capacity += len(positions)
         print(f"Room {rid}: {len(positions)} available positions")
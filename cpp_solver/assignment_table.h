@@ -0,0 +1,107 @@
+#pragma once
+
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "request_json.h"
+
+// The assignments table as one bulk-load payload, written in a single pass
+// over the solver's assignments. Rows carry kAssignmentColumns in that
+// order, so the loading statement and the payload cannot drift apart.
+//   "copy": PostgreSQL COPY text format (tab separated, backslash escapes)
+//   "csv":  RFC 4180, quoted only where needed, no header row
+
+inline constexpr const char* kAssignmentColumns = "student_id, room_id, exam_name, row, col, date";
+
+enum class TableFormat { Copy, Csv };
+
+inline TableFormat table_format(std::string_view name) {
+    if (name == "copy") return TableFormat::Copy;
+    if (name == "csv") return TableFormat::Csv;
+    throw std::invalid_argument("Unknown table format: " + std::string(name) + " (expected copy or csv)");
+}
+
+class TableWriter {
+private:
+    std::string& out_;
+    TableFormat format_;
+    bool first_ = true;
+
+public:
+    TableWriter(std::string& out, TableFormat format) : out_(out), format_(format) {}
+
+    void separator() {
+        if (!first_) out_ += format_ == TableFormat::Copy ? '\t' : ',';
+        first_ = false;
+    }
+
+    void end_row() {
+        out_ += '\n';
+        first_ = true;
+    }
+
+    void integer(long long value) {
+        separator();
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        out_.append(digits, end - digits);
+    }
+
+    void text(std::string_view value) {
+        separator();
+        if (format_ == TableFormat::Copy) {
+            for (char c : value) {
+                switch (c) {
+                    case '\\': out_ += "\\\\"; break;
+                    case '\t': out_ += "\\t"; break;
+                    case '\n': out_ += "\\n"; break;
+                    case '\r': out_ += "\\r"; break;
+                    default: out_ += c;
+                }
+            }
+            return;
+        }
+        // Unquoted empty is NULL to COPY ... CSV, so empty strings are quoted
+        if (!value.empty() && value.find_first_of(",\"\n\r") == std::string_view::npos) {
+            out_.append(value);
+            return;
+        }
+        out_ += '"';
+        for (char c : value) {
+            if (c == '"') out_ += '"';
+            out_ += c;
+        }
+        out_ += '"';
+    }
+};
+
+// exam_of(student_id) and date_of(student_id) give the student's exam and
+// the assignment date as YYYY-MM-DD.
+template <class AssignmentT, class ExamOf, class DateOf>
+std::string assignment_table(
+    const std::vector<AssignmentT>& assignments,
+    ExamOf&& exam_of,
+    DateOf&& date_of,
+    TableFormat format
+) {
+    std::string out;
+    out.reserve(assignments.size() * 64);
+    TableWriter row(out, format);
+    for (const auto& assignment : assignments) {
+        row.integer(assignment.student_id);
+        row.text(assignment.room_id);
+        row.text(exam_of(assignment.student_id));
+        row.integer(assignment.row);
+        row.integer(assignment.col);
+        std::string_view date = date_of(assignment.student_id);
+        if (!is_iso_date(date)) {
+            throw std::invalid_argument("Assignment date of student " + std::to_string(assignment.student_id) + 
+                                        " must be YYYY-MM-DD, got " + std::string(date));
+        }
+        row.text(date);
+        row.end_row();
+    }
+    return out;
+}
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <climits>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+
+// Room-level view of the seating problem: each room is a bin whose seats are
+// split into colour classes (independent sets of the seat adjacency graph) and
+// each exam is an item whose headcount must be spread over those classes.
+// Any exam chunk placed inside one colour class can never sit next to itself,
+// so every plan produced here can be turned into a valid seating directly.
+
+struct RoomBudget {
+    int seats = 0;                                 // all seats in the room
+    int exam_capacity = 0;                         // certified upper bound on seats one exam can take
+    std::vector<std::vector<int>> colour_classes;  // seat indices per colour, largest class first
+
+    // Upper bound on seats usable by k different exams sharing the room
+    int capacity_for(int k) const {
+        long long bound = static_cast<long long>(k) * exam_capacity;
+        return static_cast<int>(std::min<long long>(seats, bound));
+    }
+};
+
+struct ExamDemand {
+    int count = 0;
+    std::vector<char> allowed;  // allowed[room] != 0 if the exam may use the room
+};
+
+struct PlanChunk {
+    int exam, room, colour, count;
+};
+
+struct PackingPlan {
+    std::vector<PlanChunk> chunks;
+    int rooms_used = 0;
+    bool complete = false;
+};
+
+class BinPacker {
+private:
+    // Size of a matching in the seat graph. Maximum for bipartite rooms
+    // (Hopcroft-Karp from a greedy start), greedy maximal otherwise. Either way
+    // seats - matching bounds the largest independent set from above, because
+    // each matched pair holds at most one student of the same exam, so
+    // stopping early at `until` only loosens the bound. Matching the whole
+    // smaller colour class is maximum already and ends the search.
+    int matching_size(int num_seats, const std::vector<std::pair<int, int>>& adjacent_pairs,
+                      const std::vector<int>& colour_of, int num_colours,
+                      std::chrono::steady_clock::time_point until) {
+        if (num_colours <= 2) {
+            // Colour 0 seats on the left, edges to their colour 1 neighbours as CSR
+            std::vector<int> offset(num_seats + 1, 0);
+            int left = 0;
+            for (int s = 0; s < num_seats; s++) {
+                if (colour_of[s] == 0) left++;
+            }
+            int limit = std::min(left, num_seats - left);
+            for (const auto& edge : adjacent_pairs) {
+                offset[(colour_of[edge.first] == 0 ? edge.first : edge.second) + 1]++;
+            }
+            for (int s = 0; s < num_seats; s++) offset[s + 1] += offset[s];
+            std::vector<int> edges(offset[num_seats]);
+            std::vector<int> fill(offset.begin(), offset.end() - 1);
+            for (const auto& edge : adjacent_pairs) {
+                int a = edge.first, b = edge.second;
+                if (colour_of[a] != 0) std::swap(a, b);
+                edges[fill[a]++] = b;
+            }
+
+            std::vector<int> match(num_seats, -1);  // partner of every seat, either side
+            int size = 0;
+            for (int u = 0; u < num_seats && size < limit; u++) {
+                if (colour_of[u] != 0) continue;
+                for (int k = offset[u]; k < offset[u + 1]; k++) {
+                    if (match[edges[k]] < 0) {
+                        match[u] = edges[k];
+                        match[edges[k]] = u;
+                        size++;
+                        break;
+                    }
+                }
+            }
+
+            // Each phase layers the left seats by BFS from the free ones, then
+            // augments along vertex-disjoint shortest paths with an explicit
+            // stack, so the depth of a path never reaches the call stack
+            const int unreached = INT_MAX;
+            std::vector<int> dist(num_seats), next(num_seats), queue, stack;
+            while (size < limit && std::chrono::steady_clock::now() < until) {
+                queue.clear();
+                for (int u = 0; u < num_seats; u++) {
+                    if (colour_of[u] != 0) continue;
+                    dist[u] = match[u] < 0 ? 0 : unreached;
+                    if (match[u] < 0) queue.push_back(u);
+                }
+                bool found = false;
+                for (size_t q = 0; q < queue.size(); q++) {
+                    int u = queue[q];
+                    for (int k = offset[u]; k < offset[u + 1]; k++) {
+                        int w = match[edges[k]];
+                        if (w < 0) {
+                            found = true;
+                        } else if (dist[w] == unreached) {
+                            dist[w] = dist[u] + 1;
+                            queue.push_back(w);
+                        }
+                    }
+                }
+                if (!found) break;
+
+                for (int u = 0; u < num_seats; u++) next[u] = offset[u];
+                for (int root = 0; root < num_seats && size < limit; root++) {
+                    if (colour_of[root] != 0 || match[root] >= 0) continue;
+                    stack.assign(1, root);
+                    while (!stack.empty()) {
+                        int u = stack.back();
+                        if (next[u] == offset[u + 1]) {
+                            dist[u] = unreached;  // no path left through u this phase
+                            stack.pop_back();
+                            continue;
+                        }
+                        int v = edges[next[u]++];
+                        int w = match[v];
+                        if (w < 0) {
+                            // Flip the path: every seat on the stack takes the
+                            // edge it was last left through
+                            for (int x : stack) {
+                                int y = edges[next[x] - 1];
+                                match[x] = y;
+                                match[y] = x;
+                            }
+                            size++;
+                            break;
+                        }
+                        if (dist[w] == dist[u] + 1) stack.push_back(w);
+                    }
+                }
+            }
+            return size;
+        }
+
+        std::vector<char> matched(num_seats, 0);
+        int size = 0;
+        for (const auto& edge : adjacent_pairs) {
+            if (matched[edge.first] || matched[edge.second]) continue;
+            matched[edge.first] = matched[edge.second] = 1;
+            size++;
+        }
+        return size;
+    }
+
+    std::vector<int> rooms_by_size(const std::vector<const RoomBudget*>& rooms) {
+        std::vector<int> order(rooms.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return rooms[a]->seats > rooms[b]->seats;
+        });
+        return order;
+    }
+
+    std::vector<int> exams_by_size(const std::vector<ExamDemand>& exams) {
+        std::vector<int> order(exams.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return exams[a].count > exams[b].count;
+        });
+        return order;
+    }
+
+    PackingPlan pack(const std::vector<ExamDemand>& exams, const std::vector<const RoomBudget*>& rooms,
+                     const std::vector<std::vector<int>>& taken, bool best_fit) {
+        PackingPlan plan;
+        std::vector<std::vector<int>> remaining(rooms.size());
+        std::vector<int> last_exam(rooms.size(), -1);
+        std::vector<char> open(rooms.size(), 0);
+        std::vector<int> open_order;
+        std::vector<int> room_order = rooms_by_size(rooms);
+
+        for (size_t ki = 0; ki < rooms.size(); ki++) {
+            for (const auto& cls : rooms[ki]->colour_classes) {
+                remaining[ki].push_back(static_cast<int>(cls.size()));
+            }
+        }
+
+        // Rooms with taken seats are in use whatever the plan does, so they are
+        // open from the start with what their colour classes have left
+        std::vector<char> is_taken;
+        for (int ki : room_order) {
+            if (taken.empty() || taken[ki].empty()) continue;
+            is_taken.assign(rooms[ki]->seats, 0);
+            for (int s : taken[ki]) is_taken[s] = 1;
+            for (size_t c = 0; c < remaining[ki].size(); c++) {
+                for (int s : rooms[ki]->colour_classes[c]) remaining[ki][c] -= is_taken[s];
+            }
+            open[ki] = 1;
+            open_order.push_back(ki);
+        }
+
+        for (int e : exams_by_size(exams)) {
+            int left = exams[e].count;
+
+            while (left > 0) {
+                int best_room = -1, best_colour = -1;
+                int best_score = 0;
+
+                for (int ki : open_order) {
+                    // A room gives an exam at most one colour class, otherwise the
+                    // exam could end up next to itself across classes
+                    if (!exams[e].allowed[ki] || last_exam[ki] == e) continue;
+
+                    for (size_t c = 0; c < remaining[ki].size(); c++) {
+                        int rem = remaining[ki][c];
+                        if (rem == 0) continue;
+
+                        // First fit takes the largest free class of the first room with
+                        // space. Best fit takes the tightest class holding the whole
+                        // remainder, else the largest class anywhere.
+                        int score = (best_fit && rem >= left) ? (1 << 30) - (rem - left) : rem;
+                        if (score > best_score) {
+                            best_room = ki;
+                            best_colour = static_cast<int>(c);
+                            best_score = score;
+                        }
+                    }
+
+                    if (!best_fit && best_room >= 0) break;
+                }
+
+                if (best_room < 0) {
+                    // Open the next allowed room, largest first
+                    for (int ki : room_order) {
+                        if (!open[ki] && exams[e].allowed[ki] && rooms[ki]->seats > 0) {
+                            best_room = ki;
+                            break;
+                        }
+                    }
+                    if (best_room < 0) break;
+                    open[best_room] = 1;
+                    open_order.push_back(best_room);
+                    best_colour = 0;  // classes are sorted largest first
+                }
+
+                int take = std::min(left, remaining[best_room][best_colour]);
+                remaining[best_room][best_colour] -= take;
+                last_exam[best_room] = e;
+                plan.chunks.push_back({e, best_room, best_colour, take});
+                left -= take;
+            }
+
+            if (left > 0) {
+                plan.rooms_used = static_cast<int>(open_order.size());
+                return plan;
+            }
+        }
+
+        plan.rooms_used = static_cast<int>(open_order.size());
+        plan.complete = true;
+        return plan;
+    }
+
+    // Smallest number of rooms whose capacities can cover demand
+    int rooms_needed(std::vector<int> capacities, long long demand) {
+        if (demand <= 0) return 0;
+        std::sort(capacities.begin(), capacities.end(), std::greater<int>());
+        long long covered = 0;
+        for (size_t k = 0; k < capacities.size(); k++) {
+            covered += capacities[k];
+            if (covered >= demand) return static_cast<int>(k + 1);
+        }
+        return -1;
+    }
+
+public:
+    // Colour the seat graph greedily in seat order (checkerboard on plain grids)
+    // and compute the per-exam capacity bound. The graph comes both as an edge
+    // list and as neighbour CSR (neighbours of s are neighbours[offset[s] .. offset[s + 1])).
+    // Past `until` the capacity bound stays certified but may be loose.
+    RoomBudget compute_budget(int num_seats, const std::vector<std::pair<int, int>>& adjacent_pairs,
+                              const std::vector<int>& neighbour_offset, const std::vector<int>& neighbours,
+                              std::chrono::steady_clock::time_point until = std::chrono::steady_clock::time_point::max()) {
+        RoomBudget budget;
+        budget.seats = num_seats;
+
+        std::vector<int> colour_of(num_seats, -1);
+        int num_colours = 0;
+        std::vector<char> taken;
+        for (int s = 0; s < num_seats; s++) {
+            taken.assign(num_colours + 1, 0);
+            for (int k = neighbour_offset[s]; k < neighbour_offset[s + 1]; k++) {
+                int n = neighbours[k];
+                if (colour_of[n] >= 0) taken[colour_of[n]] = 1;
+            }
+            int colour = 0;
+            while (taken[colour]) colour++;
+            colour_of[s] = colour;
+            num_colours = std::max(num_colours, colour + 1);
+        }
+
+        budget.colour_classes.assign(num_colours, {});
+        for (int s = 0; s < num_seats; s++) {
+            budget.colour_classes[colour_of[s]].push_back(s);
+        }
+        std::stable_sort(budget.colour_classes.begin(), budget.colour_classes.end(),
+                         [](const std::vector<int>& a, const std::vector<int>& b) { return a.size() > b.size(); });
+
+        budget.exam_capacity = num_seats - matching_size(num_seats, adjacent_pairs, colour_of, num_colours, until);
+        return budget;
+    }
+
+    // taken[room] lists seats already occupied (pinned students), empty for
+    // none; those rooms count as used by every plan.
+    PackingPlan first_fit_decreasing(const std::vector<ExamDemand>& exams, const std::vector<const RoomBudget*>& rooms,
+                                     const std::vector<std::vector<int>>& taken = {}) {
+        return pack(exams, rooms, taken, false);
+    }
+
+    PackingPlan best_fit_decreasing(const std::vector<ExamDemand>& exams, const std::vector<const RoomBudget*>& rooms,
+                                    const std::vector<std::vector<int>>& taken = {}) {
+        return pack(exams, rooms, taken, true);
+    }
+
+    // Certified lower bound on rooms used by any valid seating: all students need
+    // enough seats, and each exam alone needs enough per-exam capacity among its
+    // allowed rooms. Rooms with taken seats are used anyway, so they count in
+    // full and only what their free seats cannot hold needs further rooms.
+    // Returns -1 when no seating can exist.
+    int lower_bound(const std::vector<ExamDemand>& exams, const std::vector<const RoomBudget*>& rooms,
+                    const std::vector<std::vector<int>>& taken = {}) {
+        std::vector<int> free_seats(rooms.size());
+        std::vector<char> held(rooms.size(), 0);
+        int num_held = 0;
+        for (size_t ki = 0; ki < rooms.size(); ki++) {
+            int used = taken.empty() ? 0 : static_cast<int>(taken[ki].size());
+            free_seats[ki] = rooms[ki]->seats - used;
+            if (used > 0) {
+                held[ki] = 1;
+                num_held++;
+            }
+        }
+
+        std::vector<int> seats;
+        long long total = 0;
+        for (size_t ki = 0; ki < rooms.size(); ki++) {
+            if (held[ki]) total -= free_seats[ki];
+            else seats.push_back(free_seats[ki]);
+        }
+        for (const auto& exam : exams) total += exam.count;
+
+        int bound = rooms_needed(seats, total);
+        if (bound < 0) return -1;
+
+        for (const auto& exam : exams) {
+            std::vector<int> capacities;
+            long long demand = exam.count;
+            for (size_t ki = 0; ki < rooms.size(); ki++) {
+                if (!exam.allowed[ki]) continue;
+                int capacity = std::min(rooms[ki]->exam_capacity, free_seats[ki]);
+                if (held[ki]) demand -= capacity;
+                else capacities.push_back(capacity);
+            }
+            int needed = rooms_needed(capacities, demand);
+            if (needed < 0) return -1;
+            bound = std::max(bound, needed);
+        }
+
+        return num_held + bound;
+    }
+};
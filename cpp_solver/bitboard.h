@@ -0,0 +1,416 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include "bits.h"
+#include "separation.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BITBOARD_HAVE_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define BITBOARD_AVX2_TARGET
+#else
+#define BITBOARD_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#else
+#define BITBOARD_HAVE_AVX2 0
+#endif
+
+// Rooms as row-major bitboards: cell (r, c) is bit r * stride + c. The row
+// stride is the room's width class (16, 32, 64 or a multiple of 64 bits), so
+// small rows never straddle a word. With a room stored this way, the seats
+// blocked for an exam are the OR of its occupancy shifted by every stencil
+// offset, each shift ANDed with a guard that drops bits wrapping into the
+// neighbouring row. The word loops below are the only hot code: the common
+// stencils in rooms up to 64 columns get kernels specialised on the width
+// class, everything else uses generic ones in a scalar and an AVX2 version,
+// picked once at runtime.
+
+inline int board_stride(int cols) {
+    if (cols <= 16) return 16;
+    if (cols <= 32) return 32;
+    return 64 * ((cols + 63) / 64);
+}
+
+struct BitboardKernels {
+    const char* name;
+    // dst |= (src shifted by shift bits, towards higher cells if positive) & guard
+    void (*shift_or)(uint64_t* dst, const uint64_t* src, const uint64_t* guard, int words, int shift);
+    // First bit of free & ~blocked, -1 if none
+    int (*first_free)(const uint64_t* free, const uint64_t* blocked, int words);
+    // a & b != 0
+    bool (*intersects)(const uint64_t* a, const uint64_t* b, int words);
+};
+
+// Word w of a bitset shifted up by 64 * q + b bits, given its source word s = w - q
+inline uint64_t src_word_up(const uint64_t* src, int s, int b) {
+    uint64_t v = src[s] << b;
+    if (b != 0 && s > 0) v |= src[s - 1] >> (64 - b);
+    return v;
+}
+
+// Word w of a bitset shifted down by 64 * q + b bits, given its source word s = w + q
+inline uint64_t src_word_down(const uint64_t* src, int s, int b, int words) {
+    uint64_t v = src[s] >> b;
+    if (b != 0 && s + 1 < words) v |= src[s + 1] << (64 - b);
+    return v;
+}
+
+inline void shift_or_scalar(uint64_t* dst, const uint64_t* src, const uint64_t* guard, int words, int shift) {
+    if (shift >= 0) {
+        int q = shift >> 6, b = shift & 63;
+        for (int w = q; w < words; w++) {
+            dst[w] |= src_word_up(src, w - q, b) & guard[w];
+        }
+    } else {
+        int q = (-shift) >> 6, b = (-shift) & 63;
+        for (int w = 0; w + q < words; w++) {
+            dst[w] |= src_word_down(src, w + q, b, words) & guard[w];
+        }
+    }
+}
+
+inline int first_free_scalar(const uint64_t* free, const uint64_t* blocked, int words) {
+    for (int w = 0; w < words; w++) {
+        uint64_t bits = free[w] & ~blocked[w];
+        if (bits != 0) return w * 64 + lowest_bit(bits);
+    }
+    return -1;
+}
+
+inline bool intersects_scalar(const uint64_t* a, const uint64_t* b, int words) {
+    for (int w = 0; w < words; w++) {
+        if (a[w] & b[w]) return true;
+    }
+    return false;
+}
+
+#if BITBOARD_HAVE_AVX2
+// Four words per step. Shifting a lane by 64 yields zero, so the funnel shift
+// needs no special case for word-aligned offsets; the edges where a source
+// word falls outside the board are left to the scalar loop.
+BITBOARD_AVX2_TARGET
+inline void shift_or_avx2(uint64_t* dst, const uint64_t* src, const uint64_t* guard, int words, int shift) {
+    if (shift >= 0) {
+        int q = shift >> 6, b = shift & 63;
+        if (q >= words) return;
+        // First word has no lower neighbour
+        dst[q] |= (src[0] << b) & guard[q];
+        __m128i up = _mm_cvtsi32_si128(b);
+        __m128i down = _mm_cvtsi32_si128(64 - b);
+        int w = q + 1;
+        for (; w + 4 <= words; w += 4) {
+            __m256i hi = _mm256_sll_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w - q)), up);
+            __m256i lo = _mm256_srl_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w - q - 1)), down);
+            __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(guard + w));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + w));
+            d = _mm256_or_si256(d, _mm256_and_si256(_mm256_or_si256(hi, lo), g));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), d);
+        }
+        for (; w < words; w++) {
+            uint64_t v = src[w - q] << b;
+            if (b != 0) v |= src[w - q - 1] >> (64 - b);
+            dst[w] |= v & guard[w];
+        }
+    } else {
+        int q = (-shift) >> 6, b = (-shift) & 63;
+        if (q >= words) return;
+        __m128i down = _mm_cvtsi32_si128(b);
+        __m128i up = _mm_cvtsi32_si128(64 - b);
+        int w = 0;
+        // Both src[w + q] and src[w + q + 1] of all four lanes must exist
+        for (; w + q + 5 <= words; w += 4) {
+            __m256i lo = _mm256_srl_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w + q)), down);
+            __m256i hi = _mm256_sll_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + w + q + 1)), up);
+            __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(guard + w));
+            __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + w));
+            d = _mm256_or_si256(d, _mm256_and_si256(_mm256_or_si256(hi, lo), g));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + w), d);
+        }
+        for (; w + q < words; w++) {
+            uint64_t v = src[w + q] >> b;
+            if (b != 0 && w + q + 1 < words) v |= src[w + q + 1] << (64 - b);
+            dst[w] |= v & guard[w];
+        }
+    }
+}
+
+BITBOARD_AVX2_TARGET
+inline int first_free_avx2(const uint64_t* free, const uint64_t* blocked, int words) {
+    int w = 0;
+    for (; w + 4 <= words; w += 4) {
+        __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(free + w));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blocked + w));
+        __m256i open = _mm256_andnot_si256(b, f);
+        if (!_mm256_testz_si256(open, open)) break;
+    }
+    int rest = first_free_scalar(free + w, blocked + w, words - w);
+    return rest < 0 ? -1 : w * 64 + rest;
+}
+
+BITBOARD_AVX2_TARGET
+inline bool intersects_avx2(const uint64_t* a, const uint64_t* b, int words) {
+    int w = 0;
+    for (; w + 4 <= words; w += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + w));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w));
+        if (!_mm256_testz_si256(x, y)) return true;
+    }
+    return intersects_scalar(a + w, b + w, words - w);
+}
+
+inline bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    __cpuidex(info, 7, 0);
+    return os_saves_ymm && (info[1] & (1 << 5));
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+// Kernels for this CPU. FAST_SOLVER_SIMD=scalar forces the portable version.
+inline const BitboardKernels& bitboard_kernels() {
+    static const BitboardKernels kernels = []() {
+        BitboardKernels scalar = {"scalar", shift_or_scalar, first_free_scalar, intersects_scalar};
+        const char* forced = std::getenv("FAST_SOLVER_SIMD");
+        if (forced != nullptr && std::strcmp(forced, "scalar") == 0) return scalar;
+#if BITBOARD_HAVE_AVX2
+        if (cpu_has_avx2()) return BitboardKernels{"avx2", shift_or_avx2, first_free_avx2, intersects_avx2};
+#endif
+        return scalar;
+    }();
+    return kernels;
+}
+
+// Bitboard geometry of one room shape
+struct BoardLayout {
+    // Stencils with a kernel of their own in the width classes up to 64
+    enum Form { GENERAL, CROSS, BOX };
+
+    int cols = 0;
+    int stride = 0;
+    int words = 0;
+    std::vector<uint64_t> seats;     // cells that hold a seat
+    std::vector<int> cell_of;        // packed seat index -> cell
+    std::vector<int> shifts;         // one per stencil offset, both directions; empty for explicit adjacency
+    std::vector<int> guard_of;       // guard board used by each shift
+    std::vector<uint64_t> guards;    // [g * words + w]: cells whose column can receive that shift
+    Form form = GENERAL;
+    int radius = 0;                  // BOX: Moore radius
+    // Strides up to 64 repeat one column pattern in every word, so a column
+    // guard fits in a register: column_guard[radius + dc] for |dc| <= radius
+    std::vector<uint64_t> column_guard;
+
+    const uint64_t* guard(int i) const { return guards.data() + static_cast<size_t>(guard_of[i]) * words; }
+};
+
+// Columns [lo, hi) of every row that starts in a word, for strides up to 64
+inline uint64_t row_pattern(int stride, int lo, int hi) {
+    uint64_t row = 0;
+    for (int c = lo; c < hi; c++) row |= uint64_t(1) << c;
+    uint64_t word = 0;
+    for (int base = 0; base < 64; base += stride) word |= row << base;
+    return word;
+}
+
+// forward is the half stencil from forward_stencil(); pass an empty one for
+// rooms whose adjacency is given explicitly.
+inline BoardLayout build_board(int rows, int cols, const std::vector<std::pair<int, int>>& positions,
+                               const std::vector<std::pair<int, int>>& forward) {
+    BoardLayout board;
+    board.cols = cols;
+    board.stride = board_stride(cols);
+    board.words = (rows * board.stride + 63) / 64;
+    board.seats.assign(board.words, 0);
+    for (const auto& pos : positions) {
+        int cell = pos.first * board.stride + pos.second;
+        board.cell_of.push_back(cell);
+        set_bit(board.seats.data(), cell);
+    }
+
+    std::vector<int> guard_dc;
+    for (const auto& offset : forward) {
+        for (int sign : {1, -1}) {
+            int dr = sign * offset.first, dc = sign * offset.second;
+            if (dc >= cols || -dc >= cols || dr >= rows || -dr >= rows) continue;
+            board.shifts.push_back(dr * board.stride + dc);
+
+            int g = 0;
+            while (g < static_cast<int>(guard_dc.size()) && guard_dc[g] != dc) g++;
+            if (g == static_cast<int>(guard_dc.size())) {
+                guard_dc.push_back(dc);
+                board.guards.resize(board.guards.size() + board.words, 0);
+                uint64_t* guard = board.guards.data() + static_cast<size_t>(g) * board.words;
+                int lo = dc > 0 ? dc : 0;
+                int hi = dc < 0 ? cols + dc : cols;
+                for (int r = 0; r < rows; r++) {
+                    set_bit_range(guard, r * board.stride + lo, r * board.stride + hi);
+                }
+            }
+            board.guard_of.push_back(g);
+        }
+    }
+
+    // Left/right/front/back, or a full (2r + 1) square, with every offset
+    // inside the room
+    if (board.stride <= 64 && !forward.empty()) {
+        int r = 0;
+        for (const auto& offset : forward) r = std::max({r, offset.first, std::abs(offset.second)});
+        if (r < rows && r < cols) {
+            if (forward == forward_stencil(Separation("von_neumann", 1))) {
+                board.form = BoardLayout::CROSS;
+            } else if (forward == forward_stencil(Separation("moore", r))) {
+                board.form = BoardLayout::BOX;
+            }
+        }
+        if (board.form != BoardLayout::GENERAL) {
+            board.radius = r;
+            for (int dc = -r; dc <= r; dc++) {
+                board.column_guard.push_back(row_pattern(board.stride, std::max(dc, 0), cols + std::min(dc, 0)));
+            }
+        }
+    }
+    return board;
+}
+
+// Width-class kernels. With the stride a template argument, row moves are
+// constant shifts (whole words at stride 64) and the column guards stay in
+// registers, so the word loops unroll and vectorise without guard-board
+// loads. Bits pushed past the last row are left in place: free and
+// occupancy boards never have them, so they change nothing.
+
+// Word w of a board moved by dr rows, dr > 0 towards higher rows
+template <int Stride>
+inline uint64_t rows_moved(const uint64_t* board, int w, int words, int dr) {
+    if constexpr (Stride == 64) {
+        int s = w - dr;
+        return s >= 0 && s < words ? board[s] : 0;
+    } else {
+        int shift = dr * Stride;
+        if (shift >= 0) {
+            int q = shift >> 6;
+            return w - q >= 0 ? src_word_up(board, w - q, shift & 63) : 0;
+        }
+        int q = (-shift) >> 6;
+        return w + q < words ? src_word_down(board, w + q, (-shift) & 63, words) : 0;
+    }
+}
+
+// Word w of a board moved by dc columns, ANDed with the guard for dc
+inline uint64_t cols_moved(const uint64_t* board, int w, int words, int dc, uint64_t guard) {
+    uint64_t x = board[w];
+    if (dc > 0) {
+        uint64_t prev = w > 0 ? board[w - 1] : 0;
+        return ((x << dc) | (prev >> (64 - dc))) & guard;
+    }
+    uint64_t next = w + 1 < words ? board[w + 1] : 0;
+    return ((x >> -dc) | (next << (64 + dc))) & guard;
+}
+
+// Left/right/front/back, the stencil of most rooms
+template <int Stride>
+inline void cross_blocked(const BoardLayout& board, const uint64_t* occupied, uint64_t* out) {
+    const int words = board.words;
+    const uint64_t left_guard = board.column_guard[0];
+    const uint64_t right_guard = board.column_guard[2];
+    for (int w = 0; w < words; w++) {
+        out[w] = cols_moved(occupied, w, words, 1, right_guard) | cols_moved(occupied, w, words, -1, left_guard) |
+                 rows_moved<Stride>(occupied, w, words, 1) | rows_moved<Stride>(occupied, w, words, -1);
+    }
+}
+
+// Moore radius r is separable: spread each row by up to r columns, then move
+// that spread by 1..r rows. Only the row itself must not count its own cells.
+template <int Stride>
+inline void box_blocked(const BoardLayout& board, const uint64_t* occupied, uint64_t* out) {
+    const int words = board.words;
+    const int r = board.radius;
+    thread_local std::vector<uint64_t> spread;
+    spread.resize(words);
+    for (int w = 0; w < words; w++) {
+        uint64_t sideways = 0;
+        for (int dc = 1; dc <= r; dc++) {
+            sideways |= cols_moved(occupied, w, words, dc, board.column_guard[r + dc]) |
+                        cols_moved(occupied, w, words, -dc, board.column_guard[r - dc]);
+        }
+        out[w] = sideways;
+        spread[w] = sideways | occupied[w];
+    }
+    for (int w = 0; w < words; w++) {
+        uint64_t vertical = 0;
+        for (int dr = 1; dr <= r; dr++) {
+            vertical |= rows_moved<Stride>(spread.data(), w, words, dr) | rows_moved<Stride>(spread.data(), w, words, -dr);
+        }
+        out[w] |= vertical;
+    }
+}
+
+// Moore radius 1 (the eight surrounding seats): a spread row only ever moves
+// to the neighbouring word, so a three-word window replaces the scratch board
+template <int Stride>
+inline void box1_blocked(const BoardLayout& board, const uint64_t* occupied, uint64_t* out) {
+    const int words = board.words;
+    const uint64_t left_guard = board.column_guard[0];
+    const uint64_t right_guard = board.column_guard[2];
+    auto sideways = [&](int w) {
+        return cols_moved(occupied, w, words, 1, right_guard) | cols_moved(occupied, w, words, -1, left_guard);
+    };
+    uint64_t side = words > 0 ? sideways(0) : 0;
+    uint64_t prev = 0;
+    uint64_t cur = words > 0 ? side | occupied[0] : 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t next_side = w + 1 < words ? sideways(w + 1) : 0;
+        uint64_t next = w + 1 < words ? next_side | occupied[w + 1] : 0;
+        uint64_t vertical;
+        if constexpr (Stride == 64) {
+            vertical = prev | next;
+        } else {
+            vertical = (cur << Stride) | (prev >> (64 - Stride)) | (cur >> Stride) | (next << (64 - Stride));
+        }
+        out[w] = side | vertical;
+        prev = cur;
+        cur = next;
+        side = next_side;
+    }
+}
+
+template <int Stride>
+inline bool fixed_width_blocked(const BoardLayout& board, const uint64_t* occupied, uint64_t* out) {
+    static_assert(Stride == 16 || Stride == 32 || Stride == 64, "at most one row per word");
+    switch (board.form) {
+        case BoardLayout::CROSS: cross_blocked<Stride>(board, occupied, out); return true;
+        case BoardLayout::BOX:
+            if (board.radius == 1) box1_blocked<Stride>(board, occupied, out);
+            else box_blocked<Stride>(board, occupied, out);
+            return true;
+        default: return false;
+    }
+}
+
+// Cells adjacent to any cell of occupied, under the board's stencil.
+// Dispatches on the width class; other stencils and wide rooms use the
+// guard boards with the runtime-selected kernels.
+inline void blocked_cells(const BoardLayout& board, const uint64_t* occupied, uint64_t* out) {
+    switch (board.stride) {
+        case 16: if (fixed_width_blocked<16>(board, occupied, out)) return; break;
+        case 32: if (fixed_width_blocked<32>(board, occupied, out)) return; break;
+        case 64: if (fixed_width_blocked<64>(board, occupied, out)) return; break;
+        default: break;
+    }
+    const BitboardKernels& kernels = bitboard_kernels();
+    std::memset(out, 0, sizeof(uint64_t) * board.words);
+    for (size_t i = 0; i < board.shifts.size(); i++) {
+        kernels.shift_or(out, occupied, board.guard(static_cast<int>(i)), board.words, board.shifts[i]);
+    }
+}
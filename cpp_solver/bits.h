@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Word-level helpers for the uint64_t bitsets used for rooms and seats
+
+inline int lowest_bit(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+inline int popcount(uint64_t bits) {
+#if defined(_MSC_VER)
+    return static_cast<int>(__popcnt64(bits));
+#else
+    return __builtin_popcountll(bits);
+#endif
+}
+
+inline int count_bits(const uint64_t* row, int words) {
+    int count = 0;
+    for (int w = 0; w < words; w++) count += popcount(row[w]);
+    return count;
+}
+
+inline void set_bit(uint64_t* row, int i) { row[i >> 6] |= uint64_t(1) << (i & 63); }
+inline bool test_bit(const uint64_t* row, int i) { return (row[i >> 6] >> (i & 63)) & 1; }
+inline void clear_bit(uint64_t* row, int i) { row[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+
+// Set bits [lo, hi) a word at a time
+inline void set_bit_range(uint64_t* row, int lo, int hi) {
+    while (lo < hi) {
+        int w = lo >> 6;
+        int bit = lo & 63;
+        int span = 64 - bit < hi - lo ? 64 - bit : hi - lo;
+        uint64_t mask = span == 64 ? ~uint64_t(0) : ((uint64_t(1) << span) - 1) << bit;
+        row[w] |= mask;
+        lo += span;
+    }
+}
+
+// Calls f(i) for every set bit, in increasing order
+template <class F>
+inline void for_each_bit(const uint64_t* row, int words, F&& f) {
+    for (int w = 0; w < words; w++) {
+        for (uint64_t bits = row[w]; bits != 0; bits &= bits - 1) {
+            f(w * 64 + lowest_bit(bits));
+        }
+    }
+}
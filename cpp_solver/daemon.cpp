@@ -0,0 +1,387 @@
+// Long-lived solver process. Jobs arrive on a Unix domain socket; the
+// instance and the solution columns travel through a POSIX shared-memory
+// segment the client creates, so only a few hundred bytes cross the socket.
+// The process keeps its caches (solved instances, warm-start seatings, the
+// selected bitboard kernels) across requests, and a crash takes down this
+// process instead of the API server. POSIX only.
+//
+// Built from the same sources as the Python module, without the bindings:
+//   python setup.py build_daemon
+//   ./fast_solver_daemon [--socket PATH] [--cache-dir DIR] [--threads N]
+// The socket defaults to $FAST_SOLVER_SOCKET, then /tmp/fast_solver.sock;
+// the task pool to $FAST_SOLVER_THREADS, then one thread per core.
+//
+// Frames on the socket are a uint32 length and a ByteWriter payload.
+//   request: op ("ping", "stats" or "solve"), then for "solve": segment name,
+//            segment size, solution offset, options (see read_options)
+//   reply:   error ("" on success), then per op: "pong"; cache and task pool counters;
+//            or the SolveResult fields (see write_result)
+// The segment holds the instance from offset 0 (see read_instance) and
+// receives three int32 columns at the solution offset: room index, row and
+// col of every student, room -1 for students left unseated.
+#define FAST_SOLVER_NO_PYTHON
+#include "solver.cpp"
+
+#include <csignal>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static constexpr uint32_t kInstanceMagic = 0x31495346;  // "FSI1"
+static constexpr uint32_t kMaxFrameBytes = 1 << 20;
+
+static std::atomic<bool> shutting_down{false};
+static std::atomic<long long> jobs_served{0};
+static int listen_fd = -1;
+
+// Shared-memory segment created by the client, mapped for one job
+class SharedSegment {
+private:
+    void* data_ = MAP_FAILED;
+    size_t size_ = 0;
+
+public:
+    SharedSegment(const std::string& name, size_t size) : size_(size) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) throw std::runtime_error("Cannot open shared memory " + name + ": " + std::strerror(errno));
+        struct stat info;
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < size) {
+            close(fd);
+            throw std::runtime_error("Shared memory " + name + " is smaller than announced");
+        }
+        data_ = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data_ == MAP_FAILED) throw std::runtime_error("Cannot map shared memory " + name + ": " + std::strerror(errno));
+    }
+    ~SharedSegment() {
+        if (data_ != MAP_FAILED) munmap(data_, size_);
+    }
+    SharedSegment(const SharedSegment&) = delete;
+    SharedSegment& operator=(const SharedSegment&) = delete;
+
+    char* data() { return static_cast<char*>(data_); }
+    size_t size() const { return size_; }
+};
+
+struct Instance {
+    std::vector<Student> students;
+    std::vector<Room> rooms;
+    std::unordered_map<std::string, std::vector<std::string>> restrictions;
+    std::vector<Pin> pins;
+};
+
+// Instance layout, every count a uint32:
+//   magic, students n, file_number int32[n], exam index uint32[n],
+//   exams m, exam code string[m],
+//   rooms, per room: id, rows, cols, skip_rows (uint8), skip_cols,
+//                    mask row count, mask rows, adjacency count, int32 pairs,
+//   restrictions, per exam: code, room count, room ids,
+//   pins, per pin: student_id, room_id, row, col
+static Instance read_instance(std::string_view bytes) {
+    ByteReader in(bytes);
+    auto fail = [](const char* what) { throw std::invalid_argument(std::string("Malformed instance: ") + what); };
+    uint32_t magic = 0, count = 0;
+    if (!in.get(magic) || magic != kInstanceMagic) fail("bad magic");
+
+    Instance instance;
+    std::vector<int32_t> file_number;
+    std::vector<uint32_t> exam_index;
+    if (!in.get(count) || !in.get_array(file_number, count) || !in.get_array(exam_index, count)) fail("students");
+    uint32_t num_exams = 0;
+    if (!in.get(num_exams) || num_exams > bytes.size()) fail("exams");
+    std::vector<std::string> exams(num_exams);
+    for (auto& exam : exams) {
+        if (!in.get(exam)) fail("exams");
+    }
+    instance.students.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        if (exam_index[i] >= num_exams) fail("exam index out of range");
+        instance.students.emplace_back(file_number[i], exams[exam_index[i]]);
+    }
+
+    if (!in.get(count) || count > bytes.size()) fail("rooms");
+    instance.rooms.reserve(count);
+    for (uint32_t k = 0; k < count; k++) {
+        std::string id;
+        int32_t rows = 0, cols = 0, skip_cols = 0;
+        uint8_t skip_rows = 0;
+        uint32_t mask_rows = 0, pairs = 0;
+        if (!in.get(id) || !in.get(rows) || !in.get(cols) || !in.get(skip_rows) || !in.get(skip_cols) ||
+            !in.get(mask_rows) || mask_rows > bytes.size()) {
+            fail("rooms");
+        }
+        std::vector<std::string> mask(mask_rows);
+        for (auto& row : mask) {
+            if (!in.get(row)) fail("seat mask");
+        }
+        std::vector<int32_t> flat;
+        if (!in.get(pairs) || pairs > bytes.size() || !in.get_array(flat, static_cast<size_t>(pairs) * 2)) fail("adjacency");
+        if (mask.empty()) {
+            instance.rooms.emplace_back(id, rows, cols, skip_rows != 0, skip_cols);
+        } else {
+            std::vector<std::pair<int, int>> adjacency(pairs);
+            for (uint32_t p = 0; p < pairs; p++) adjacency[p] = {flat[2 * p], flat[2 * p + 1]};
+            instance.rooms.push_back(Room::from_mask(id, mask, adjacency));
+        }
+    }
+
+    if (!in.get(count) || count > bytes.size()) fail("restrictions");
+    for (uint32_t r = 0; r < count; r++) {
+        std::string exam;
+        uint32_t room_count = 0;
+        if (!in.get(exam) || !in.get(room_count) || room_count > bytes.size()) fail("restrictions");
+        auto& room_ids = instance.restrictions[exam];
+        room_ids.resize(room_count);
+        for (auto& room_id : room_ids) {
+            if (!in.get(room_id)) fail("restrictions");
+        }
+    }
+
+    if (!in.get(count) || count > bytes.size()) fail("pins");
+    for (uint32_t p = 0; p < count; p++) {
+        int32_t student_id = 0, row = -1, col = -1;
+        std::string room_id;
+        if (!in.get(student_id) || !in.get(room_id) || !in.get(row) || !in.get(col)) fail("pins");
+        instance.pins.emplace_back(student_id, room_id, row, col);
+    }
+    return instance;
+}
+
+// Options in SolveOptions declaration order; the progress callback stays
+// in process
+static bool read_options(ByteReader& in, SolveOptions& options) {
+    int32_t timeout = 0, accept_gap = 0, memory_limit = 0, starts = 0, threads = 0, spread = 0, balance = 0, radius = 0;
+    uint8_t use_cache = 1, decompose = 1;
+    uint32_t offsets = 0;
+    std::vector<int32_t> flat;
+    bool ok = in.get(options.mode) && in.get(timeout) && in.get(accept_gap) && in.get(options.formulation) &&
+              in.get(starts) && in.get(options.seed) && in.get(threads) && in.get(memory_limit) &&
+              in.get(options.separation.kind) && in.get(radius) && in.get(offsets) && offsets < kMaxFrameBytes &&
+              in.get_array(flat, static_cast<size_t>(offsets) * 2) && in.get(spread) && in.get(balance) &&
+              in.get(options.separation_mode) && in.get(decompose) && in.get(use_cache);
+    if (!ok) return false;
+    options.timeout_seconds = timeout;
+    options.accept_gap = accept_gap;
+    options.greedy_starts = starts;
+    options.num_threads = threads;
+    options.memory_limit_mb = memory_limit;
+    options.separation.radius = radius;
+    options.separation.offsets.clear();
+    for (uint32_t i = 0; i < offsets; i++) options.separation.offsets.push_back({flat[2 * i], flat[2 * i + 1]});
+    options.spread_weight = spread;
+    options.balance_weight = balance;
+    options.decompose = decompose != 0;
+    options.use_cache = use_cache != 0;
+    return true;
+}
+
+static void write_result(ByteWriter& out, const SolveResult& result) {
+    out.put(result.status);
+    out.put(result.engine);
+    out.put(result.formulation);
+    out.put(static_cast<int32_t>(result.rooms_used));
+    out.put(static_cast<int32_t>(result.lower_bound));
+    out.put(static_cast<int32_t>(result.gap));
+    out.put(static_cast<uint8_t>(result.valid));
+    out.put(static_cast<int64_t>(result.solve_ms));
+    out.put(static_cast<int64_t>(result.model_variables));
+    out.put(result.peak_rss_mb);
+    out.put(static_cast<uint64_t>(result.seed));
+    out.put(static_cast<int32_t>(result.exam_rooms));
+    out.put(static_cast<int32_t>(result.max_fill_percent));
+    out.put(static_cast<uint8_t>(result.cached));
+    out.put(result.instance_key);
+    out.put(static_cast<uint32_t>(result.assignments.size()));
+}
+
+static std::string solve_job(ByteReader& in) {
+    std::string name;
+    uint64_t size = 0, solution_offset = 0;
+    SolveOptions options;
+    if (!in.get(name) || !in.get(size) || !in.get(solution_offset) || !read_options(in, options)) {
+        throw std::invalid_argument("Malformed solve request");
+    }
+    if (solution_offset > size) throw std::invalid_argument("Solution offset past the end of the segment");
+
+    SharedSegment segment(name, static_cast<size_t>(size));
+    Instance instance = read_instance(std::string_view(segment.data(), static_cast<size_t>(solution_offset)));
+    size_t n = instance.students.size();
+    if ((size - solution_offset) / (3 * sizeof(int32_t)) < n) {
+        throw std::invalid_argument("No room for the solution columns in the segment");
+    }
+
+    options.pins = std::move(instance.pins);
+    FastSeatingOptimizer optimizer;
+    SolveResult result = optimizer.run(instance.students, instance.rooms, instance.restrictions, options);
+
+    std::unordered_map<int, int32_t> student_index;
+    student_index.reserve(n);
+    for (size_t i = 0; i < n; i++) student_index.emplace(instance.students[i].id, static_cast<int32_t>(i));
+    std::unordered_map<std::string_view, int32_t> room_index;
+    for (size_t k = 0; k < instance.rooms.size(); k++) room_index.emplace(instance.rooms[k].id, static_cast<int32_t>(k));
+
+    std::vector<int32_t> room(n, -1), row(n, -1), col(n, -1);
+    for (const auto& assignment : result.assignments) {
+        auto student = student_index.find(assignment.student_id);
+        auto seat_room = room_index.find(assignment.room_id);
+        if (student == student_index.end() || seat_room == room_index.end()) continue;
+        room[student->second] = seat_room->second;
+        row[student->second] = assignment.row;
+        col[student->second] = assignment.col;
+    }
+    char* columns = segment.data() + solution_offset;
+    std::memcpy(columns, room.data(), n * sizeof(int32_t));
+    std::memcpy(columns + n * sizeof(int32_t), row.data(), n * sizeof(int32_t));
+    std::memcpy(columns + 2 * n * sizeof(int32_t), col.data(), n * sizeof(int32_t));
+
+    ByteWriter out;
+    out.put(std::string());
+    write_result(out, result);
+    return out.bytes();
+}
+
+static std::string handle_frame(const std::string& frame) {
+    ByteReader in(frame);
+    std::string op;
+    try {
+        if (!in.get(op)) throw std::invalid_argument("Missing op");
+        ByteWriter out;
+        if (op == "ping") {
+            out.put(std::string());
+            out.put(std::string("pong"));
+            return out.bytes();
+        }
+        if (op == "stats") {
+            SolutionCache& cache = solution_cache();
+            out.put(std::string());
+            out.put(static_cast<int64_t>(jobs_served.load()));
+            out.put(static_cast<int64_t>(cache.solved.size()));
+            out.put(static_cast<int64_t>(cache.warm.size()));
+            out.put(static_cast<int64_t>(cache.hits.load()));
+            out.put(static_cast<int64_t>(cache.misses.load()));
+            TaskPoolStats pool = task_pool().stats();
+            out.put(static_cast<int64_t>(pool.threads));
+            out.put(static_cast<int64_t>(pool.queued));
+            out.put(static_cast<int64_t>(pool.steals));
+            return out.bytes();
+        }
+        if (op == "solve") {
+            std::string reply = solve_job(in);
+            jobs_served++;
+            return reply;
+        }
+        throw std::invalid_argument("Unknown op " + op);
+    } catch (const std::exception& e) {
+        std::cout << "Job failed: " << e.what() << std::endl;
+        ByteWriter out;
+        out.put(std::string(e.what()));
+        return out.bytes();
+    }
+}
+
+static bool read_exact(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t got = read(fd, data, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        data += got;
+        size -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+static bool write_exact(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = write(fd, data, size);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// One client connection: frames are answered in order until it hangs up
+static void serve_connection(int fd) {
+    std::string frame;
+    uint32_t length = 0;
+    while (read_exact(fd, reinterpret_cast<char*>(&length), sizeof(length))) {
+        if (length > kMaxFrameBytes) break;
+        frame.resize(length);
+        if (!read_exact(fd, frame.data(), length)) break;
+        std::string reply = handle_frame(frame);
+        uint32_t reply_length = static_cast<uint32_t>(reply.size());
+        if (!write_exact(fd, reinterpret_cast<const char*>(&reply_length), sizeof(reply_length)) ||
+            !write_exact(fd, reply.data(), reply.size())) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+static void request_shutdown(int) {
+    shutting_down = true;
+    if (listen_fd >= 0) shutdown(listen_fd, SHUT_RDWR);
+}
+
+int main(int argc, char** argv) {
+    const char* env_socket = std::getenv("FAST_SOLVER_SOCKET");
+    std::string socket_path = env_socket != nullptr && *env_socket != '\0' ? env_socket : "/tmp/fast_solver.sock";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--socket") {
+            socket_path = argv[i + 1];
+        } else if (flag == "--cache-dir") {
+            std::lock_guard<std::mutex> lock(solution_cache().directory_mutex);
+            solution_cache().directory = argv[i + 1];
+        } else if (flag == "--threads") {
+            task_pool().resize(std::atoi(argv[i + 1]));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--socket PATH] [--cache-dir DIR] [--threads N]" << std::endl;
+            return 2;
+        }
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << socket_path << std::endl;
+        return 2;
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    std::signal(SIGPIPE, SIG_IGN);
+    struct sigaction action{};
+    action.sa_handler = request_shutdown;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path.c_str());
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listen_fd, 64) != 0) {
+        std::cerr << "Cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cout << "Solver daemon listening on " << socket_path << " (" << bitboard_kernels().name << " kernels)" << std::endl;
+
+    while (!shutting_down) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (!shutting_down) std::cerr << "accept: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        std::thread(serve_connection, fd).detach();
+    }
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    std::cout << "Solver daemon stopped after " << jobs_served.load() << " jobs" << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <string>
+
+// One time budget for a whole solve, from parsing the request to the
+// verified answer. A phase may use a share of the time left when it begins,
+// after the reserve of the phases behind it, so a slow phase cuts into
+// later ones instead of running past the deadline:
+//   parse     the request body (timed, not interrupted)
+//   presolve  pins, problem, seat catalogue, packing plan, greedy restarts
+//   build     the CP-SAT model; abandoned past its share, keeping the plan
+//   search    CP-SAT and its lazy separation rounds, up to the reserves
+//   repair    the last solution checked against the best seating so far
+//   verify    verification and the answer itself, never skipped
+
+enum class Phase { Parse, Presolve, Build, Search, Repair, Verify };
+
+class Deadline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    static constexpr int kPhases = 6;
+    // Share of the time left (after the reserves behind it) a phase may use
+    static constexpr std::array<double, kPhases> kShare = {0.10, 0.25, 0.30, 1.0, 1.0, 1.0};
+    // Share of the whole budget held back for repair and verify
+    static constexpr std::array<double, kPhases> kReserve = {0, 0, 0, 0, 0.05, 0.02};
+
+    Clock::time_point start_;
+    Clock::time_point end_;
+    Phase phase_ = Phase::Parse;
+    Clock::time_point phase_start_;
+    Clock::time_point phase_end_;
+    std::array<long long, kPhases> spent_ms_{};
+
+    Clock::duration reserve_after(Phase phase) const {
+        double share = 0;
+        for (int p = static_cast<int>(phase) + 1; p < kPhases; p++) share += kReserve[p];
+        return std::chrono::duration_cast<Clock::duration>((end_ - start_) * share);
+    }
+
+public:
+    // seconds from start; start is earlier than now when parsing has
+    // already used part of the budget
+    explicit Deadline(double seconds, Clock::time_point start = Clock::now())
+        : start_(start),
+          end_(start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(std::max(0.0, seconds)))),
+          phase_start_(start),
+          phase_end_(end_) {
+        begin(Phase::Parse, start);
+    }
+
+    // Ends the current phase and starts the next; phases only move forward
+    void begin(Phase phase, Clock::time_point now = Clock::now()) {
+        if (phase < phase_) return;
+        spent_ms_[static_cast<int>(phase_)] +=
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - phase_start_).count();
+        phase_ = phase;
+        phase_start_ = now;
+        Clock::duration left = std::max(Clock::duration::zero(), end_ - now - reserve_after(phase));
+        phase_end_ = now + std::chrono::duration_cast<Clock::duration>(left * kShare[static_cast<int>(phase)]);
+    }
+
+    Phase phase() const { return phase_; }
+    Clock::time_point end() const { return end_; }
+    Clock::time_point phase_end() const { return phase_end_; }
+
+    bool expired() const { return Clock::now() >= end_; }
+    bool phase_expired() const { return Clock::now() >= phase_end_; }
+
+    double remaining_seconds() const {
+        return std::max(0.0, std::chrono::duration<double>(end_ - Clock::now()).count());
+    }
+    double phase_seconds() const {
+        return std::max(0.0, std::chrono::duration<double>(phase_end_ - Clock::now()).count());
+    }
+
+    static const char* name(Phase phase) {
+        static const char* names[kPhases] = {"parse", "presolve", "build", "search", "repair", "verify"};
+        return names[static_cast<int>(phase)];
+    }
+
+    // "parse 3 ms, presolve 12 ms, ..." up to the current phase
+    std::string summary(Clock::time_point now = Clock::now()) const {
+        std::string out;
+        for (int p = 0; p <= static_cast<int>(phase_); p++) {
+            long long ms = spent_ms_[p];
+            if (p == static_cast<int>(phase_)) {
+                ms += std::chrono::duration_cast<std::chrono::milliseconds>(now - phase_start_).count();
+            }
+            if (!out.empty()) out += ", ";
+            out += name(static_cast<Phase>(p));
+            out += ' ';
+            out += std::to_string(ms);
+            out += " ms";
+        }
+        return out;
+    }
+};
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "bits.h"
+#include "symbol_table.h"
+
+// Integer view of one solve request. Students, rooms and exams are dense
+// indices; names are only looked up again when results leave the solver.
+// Every array lives in the per-solve arena, so building and dropping the
+// problem costs a handful of allocations from an unshared resource.
+
+// Seat of one student, room -1 if unseated
+struct SeatRef {
+    int32_t room = -1;
+    int32_t row = -1;
+    int32_t col = -1;
+};
+
+using Seating = std::pmr::vector<SeatRef>;  // indexed by student
+
+// Seat held by a pinned student. Pinned students are seated before the solve
+// and are not part of the problem; the seat is closed to every exam and its
+// neighbours to the pinned student's exam.
+struct SeatHold {
+    int32_t room;
+    int32_t position;  // index into the room's packed seats
+    int32_t exam;      // -1 if no unpinned student shares the exam
+};
+
+// Exam x room restriction matrix, one bitset of rooms per exam
+class RoomBitsets {
+private:
+    int words_ = 0;
+    std::pmr::vector<uint64_t> bits_;
+
+public:
+    explicit RoomBitsets(std::pmr::memory_resource* arena) : bits_(arena) {}
+
+    void reset(int num_exams, int num_rooms, bool value) {
+        words_ = (num_rooms + 63) / 64;
+        bits_.assign(static_cast<size_t>(num_exams) * words_, value ? ~uint64_t(0) : 0);
+        // Keep the padding bits past the last room clear
+        if (value && num_rooms % 64 != 0) {
+            for (int e = 0; e < num_exams; e++) {
+                bits_[static_cast<size_t>(e) * words_ + words_ - 1] = (uint64_t(1) << (num_rooms % 64)) - 1;
+            }
+        }
+    }
+
+    void clear_exam(int e) {
+        std::fill(bits_.begin() + static_cast<size_t>(e) * words_, bits_.begin() + static_cast<size_t>(e + 1) * words_, 0);
+    }
+    void set(int e, int k) { set_bit(bits_.data() + static_cast<size_t>(e) * words_, k); }
+    bool test(int e, int k) const { return test_bit(row(e), k); }
+
+    int words() const { return words_; }
+    const uint64_t* row(int e) const { return bits_.data() + static_cast<size_t>(e) * words_; }
+};
+
+// Calls f(k) for every room set in a bitset row, in increasing order
+template <class F>
+inline void for_each_room(const uint64_t* row, int words, F&& f) {
+    for_each_bit(row, words, f);
+}
+
+struct Problem {
+    int num_students = 0;
+    int num_rooms = 0;
+    int num_exams = 0;
+    SymbolTable exams;                       // exam code -> exam ID
+    SymbolTable room_ids;                    // room ID -> room index
+    std::pmr::vector<int32_t> exam_of;       // student -> exam
+    std::pmr::vector<int32_t> exam_offset;   // students of exam e: exam_members[exam_offset[e] .. exam_offset[e + 1])
+    std::pmr::vector<int32_t> exam_members;
+    RoomBitsets allowed;                     // rooms each exam may use
+    std::pmr::vector<char> restricted;       // exam has an explicit room list
+    std::pmr::vector<SeatHold> holds;        // seats of pinned students
+
+    explicit Problem(std::pmr::memory_resource* arena)
+        : exams(arena), room_ids(arena), exam_of(arena), exam_offset(arena), exam_members(arena),
+          allowed(arena), restricted(arena), holds(arena) {}
+
+    int exam_size(int e) const { return exam_offset[e + 1] - exam_offset[e]; }
+    const int32_t* exam_begin(int e) const { return exam_members.data() + exam_offset[e]; }
+    const int32_t* exam_end(int e) const { return exam_members.data() + exam_offset[e + 1]; }
+    bool is_allowed(int e, int k) const { return allowed.test(e, k); }
+};
+
+// Intern exam codes and room IDs once per request and resolve restrictions
+// to per-exam room bitsets. After this, every inner-loop check is an integer
+// compare or a bit test.
+template <class StudentT, class RoomT>
+Problem build_problem(
+    const std::vector<StudentT>& students,
+    const std::vector<RoomT>& rooms,
+    const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+    std::pmr::memory_resource* arena
+) {
+    Problem problem(arena);
+    problem.num_students = static_cast<int>(students.size());
+    problem.num_rooms = static_cast<int>(rooms.size());
+
+    std::pmr::vector<int32_t> counts(arena);
+    problem.exam_of.resize(students.size());
+    for (size_t i = 0; i < students.size(); i++) {
+        int32_t e = problem.exams.intern(students[i].exam);
+        if (e == static_cast<int32_t>(counts.size())) counts.push_back(0);
+        problem.exam_of[i] = e;
+        counts[e]++;
+    }
+    problem.num_exams = problem.exams.size();
+
+    problem.exam_offset.assign(counts.size() + 1, 0);
+    for (size_t e = 0; e < counts.size(); e++) {
+        problem.exam_offset[e + 1] = problem.exam_offset[e] + counts[e];
+    }
+    problem.exam_members.resize(students.size());
+    std::pmr::vector<int32_t> fill(problem.exam_offset.begin(), problem.exam_offset.end() - 1, arena);
+    for (size_t i = 0; i < students.size(); i++) {
+        problem.exam_members[fill[problem.exam_of[i]]++] = static_cast<int32_t>(i);
+    }
+
+    // Room k must be symbol k, or restrictions would land on the wrong room
+    problem.room_ids.reserve(rooms.size());
+    for (size_t k = 0; k < rooms.size(); k++) {
+        if (problem.room_ids.intern(rooms[k].id) != static_cast<int32_t>(k)) {
+            throw std::invalid_argument("Duplicate room ID: " + std::string(rooms[k].id));
+        }
+    }
+
+    problem.allowed.reset(problem.num_exams, problem.num_rooms, true);
+    problem.restricted.assign(counts.size(), 0);
+    for (const auto& restriction : restrictions) {
+        int32_t e = problem.exams.find(restriction.first);
+        if (e < 0) continue;
+
+        problem.allowed.clear_exam(e);
+        problem.restricted[e] = 1;
+        for (const auto& room_id : restriction.second) {
+            int32_t k = problem.room_ids.find(room_id);
+            if (k >= 0) problem.allowed.set(e, k);
+        }
+    }
+
+    return problem;
+}
+
+// Every seat of every room in one index space: position p of room k is seat
+// room_offset[k] + p. Restrictions are compiled once into a bitset of seats
+// per exam, so "may exam e sit here" and "which seats are left for exam e"
+// become word-parallel mask operations.
+struct SeatCatalogue {
+    int total_seats = 0;
+    int words = 0;
+    std::pmr::vector<int32_t> room_offset;   // seats of room k: [room_offset[k], room_offset[k + 1])
+    std::pmr::vector<uint64_t> exam_seats;   // [e * words + w]
+
+    explicit SeatCatalogue(std::pmr::memory_resource* arena) : room_offset(arena), exam_seats(arena) {}
+
+    int seat(int k, int position) const { return room_offset[k] + position; }
+    const uint64_t* exam_row(int e) const { return exam_seats.data() + static_cast<size_t>(e) * words; }
+    bool exam_may_use(int e, int seat) const { return test_bit(exam_row(e), seat); }
+
+    // Close a seat to one exam, or to every exam
+    void close_seat(int e, int seat) { clear_bit(exam_seats.data() + static_cast<size_t>(e) * words, seat); }
+    void close_seat(int seat) {
+        for (size_t row = 0; row < exam_seats.size(); row += words) clear_bit(exam_seats.data() + row, seat);
+    }
+};
+
+inline SeatCatalogue build_seat_catalogue(
+    const Problem& problem,
+    const std::vector<int>& seats_per_room,
+    std::pmr::memory_resource* arena
+) {
+    SeatCatalogue catalogue(arena);
+    catalogue.room_offset.assign(1, 0);
+    for (int seats : seats_per_room) {
+        catalogue.room_offset.push_back(catalogue.room_offset.back() + seats);
+    }
+    catalogue.total_seats = catalogue.room_offset.back();
+    catalogue.words = (catalogue.total_seats + 63) / 64;
+
+    catalogue.exam_seats.assign(static_cast<size_t>(problem.num_exams) * catalogue.words, 0);
+    for (int e = 0; e < problem.num_exams; e++) {
+        uint64_t* row = catalogue.exam_seats.data() + static_cast<size_t>(e) * catalogue.words;
+        for_each_room(problem.allowed.row(e), problem.allowed.words(), [&](int k) {
+            set_bit_range(row, catalogue.room_offset[k], catalogue.room_offset[k + 1]);
+        });
+    }
+
+    return catalogue;
+}
+
+// Independent sub-problems: exam e and room k are linked when e may use k,
+// and two components share no exam and no room. Restrictions that confine
+// groups of exams to disjoint room sets split a request into several
+// components that can be solved on their own. Rooms no exam may use belong
+// to no component. Largest component (by students) first.
+struct Component {
+    std::vector<int> exams;
+    std::vector<int> rooms;
+    int students = 0;
+};
+
+inline std::vector<Component> find_components(const Problem& problem) {
+    // Union-find over exams [0, num_exams) and rooms [num_exams, num_exams + num_rooms)
+    std::vector<int> parent(problem.num_exams + problem.num_rooms);
+    for (size_t v = 0; v < parent.size(); v++) parent[v] = static_cast<int>(v);
+    auto find = [&](int v) {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    };
+
+    for (int e = 0; e < problem.num_exams; e++) {
+        for_each_room(problem.allowed.row(e), problem.allowed.words(), [&](int k) {
+            int a = find(e), b = find(problem.num_exams + k);
+            if (a != b) parent[b] = a;
+        });
+    }
+
+    std::vector<int> component_of(parent.size(), -1);
+    std::vector<Component> components;
+    for (int e = 0; e < problem.num_exams; e++) {
+        int root = find(e);
+        if (component_of[root] < 0) {
+            component_of[root] = static_cast<int>(components.size());
+            components.emplace_back();
+        }
+        Component& component = components[component_of[root]];
+        component.exams.push_back(e);
+        component.students += problem.exam_size(e);
+    }
+    for (int k = 0; k < problem.num_rooms; k++) {
+        int root = find(problem.num_exams + k);
+        if (component_of[root] >= 0) components[component_of[root]].rooms.push_back(k);
+    }
+
+    std::stable_sort(components.begin(), components.end(), [](const Component& a, const Component& b) {
+        return a.students > b.students;
+    });
+    return components;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One improving solution seen during an anytime solve
+struct ProgressUpdate {
+    long long sequence = 0;   // increases by one per published update
+    long long elapsed_ms = 0;
+    int rooms_used = 0;
+    int lower_bound = 0;
+    std::string engine;
+    // Compact snapshot, one entry per student in input order (-1 if unseated)
+    std::vector<int> room_of;
+    std::vector<int> row_of;
+    std::vector<int> col_of;
+};
+
+// Latest-value slot written by the solver thread and polled by any other
+// thread. Readers never block the solver: the sequence counter is a plain
+// atomic and each update is an immutable object swapped in as a whole.
+class ProgressSlot {
+private:
+    std::shared_ptr<const ProgressUpdate> latest_;
+    std::atomic<long long> sequence_{0};
+
+public:
+    long long publish(ProgressUpdate update) {
+        update.sequence = sequence_.load(std::memory_order_relaxed) + 1;
+        long long sequence = update.sequence;
+        std::atomic_store(&latest_, std::shared_ptr<const ProgressUpdate>(
+            std::make_shared<ProgressUpdate>(std::move(update))));
+        sequence_.store(sequence, std::memory_order_release);
+        return sequence;
+    }
+
+    std::shared_ptr<const ProgressUpdate> latest() const {
+        return std::atomic_load(&latest_);
+    }
+
+    long long sequence() const {
+        return sequence_.load(std::memory_order_acquire);
+    }
+
+    void reset() {
+        std::atomic_store(&latest_, std::shared_ptr<const ProgressUpdate>());
+        sequence_.store(0, std::memory_order_release);
+    }
+};
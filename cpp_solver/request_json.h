@@ -0,0 +1,598 @@
+#pragma once
+
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "bits.h"
+#include "separation.h"
+
+// Body of an /assignments/assign request, parsed straight from the bytes the
+// server received into columns. Field names, optional fields and defaults
+// follow models.AssignRequest; unknown fields are skipped, as Pydantic does.
+// Every value is type and range checked; a bad body throws
+// std::invalid_argument naming the field, e.g. "students[12].file_number".
+
+// Eight bytes at a time, a mask with the high bit set in the first byte that
+// is a quote, a backslash or a control character, i.e. the first byte a JSON
+// string cannot hold as is. Bytes after the first flagged one may be flagged
+// spuriously; only the lowest flag is meaningful.
+inline uint64_t json_special_bytes(uint64_t word) {
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    uint64_t quote = word ^ (ones * '"');
+    uint64_t backslash = word ^ (ones * '\\');
+    uint64_t found = ((quote - ones) & ~quote) | ((backslash - ones) & ~backslash) | ((word - ones * 0x20) & ~word);
+    return found & highs;
+}
+
+// YYYY-MM-DD naming a real day of the Gregorian calendar
+inline bool is_iso_date(std::string_view text) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    for (int i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+        if (text[i] < '0' || text[i] > '9') return false;
+    }
+    int year = (text[0] - '0') * 1000 + (text[1] - '0') * 100 + (text[2] - '0') * 10 + (text[3] - '0');
+    int month = (text[5] - '0') * 10 + (text[6] - '0');
+    int day = (text[8] - '0') * 10 + (text[9] - '0');
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (year < 1 || month < 1 || month > 12 || day < 1) return false;
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return day <= days[month - 1] + (month == 2 && leap ? 1 : 0);
+}
+
+// One string field of every student, back to back in a single buffer
+class TextColumn {
+private:
+    std::string text_;
+    std::vector<uint32_t> end_;
+
+public:
+    // Append the next value to buffer(), then close() it
+    std::string& buffer() { return text_; }
+    void close() { end_.push_back(static_cast<uint32_t>(text_.size())); }
+
+    std::string_view operator[](size_t i) const {
+        size_t begin = i == 0 ? 0 : end_[i - 1];
+        return std::string_view(text_.data() + begin, end_[i] - begin);
+    }
+    size_t size() const { return end_.size(); }
+    size_t bytes() const { return text_.size(); }
+};
+
+struct RequestStudents {
+    std::vector<int32_t> file_number;
+    TextColumn name;
+    TextColumn major;
+    TextColumn examination_date;  // YYYY-MM-DD, checked to be a real date
+    TextColumn course_code;
+    TextColumn course_name;
+    TextColumn language;
+    TextColumn academic_year;
+    TextColumn time;
+
+    size_t size() const { return file_number.size(); }
+};
+
+struct RequestRoom {
+    std::string room_id;
+    int rows = 0;
+    int cols = 0;
+    bool skip_rows = false;
+    int skip_cols = 0;
+    std::vector<std::string> seat_mask;                // empty for a plain grid
+    std::vector<std::pair<int, int>> adjacency;
+};
+
+struct RequestPin {
+    int file_number = 0;
+    std::string room_id;
+    int row = -1;  // -1 for any seat of the room
+    int col = -1;
+};
+
+struct AssignRequestData {
+    RequestStudents students;
+    std::vector<RequestRoom> rooms;
+    std::unordered_map<std::string, std::vector<std::string>> restrictions;
+    std::optional<Separation> separation;  // unset: left/right/front/back
+    std::vector<RequestPin> pins;
+    double parse_seconds = 0;  // time taken to parse, charged to the solve's time budget
+};
+
+class AssignRequestParser {
+private:
+    static constexpr int kMaxDepth = 64;
+    static constexpr int kMaxRoomSide = 1000;
+    static constexpr int kMaxRadius = 16;
+
+    // Field or element being read, for error messages only
+    struct PathPart {
+        const char* key;
+        int index;  // -1 for a field
+    };
+
+    const char* begin_;
+    const char* at_;
+    const char* end_;
+    std::vector<PathPart> path_;
+    std::vector<std::string> keys_;  // key being read at each object depth
+    int depth_ = 0;
+    int skipping_ = 0;               // inside a skipped value, whose elements are not on the path
+    std::string skipped_;            // scratch for strings of skipped values
+
+    explicit AssignRequestParser(std::string_view body)
+        : begin_(body.data()), at_(body.data()), end_(body.data() + body.size()) {
+        path_.reserve(8);
+        keys_.resize(kMaxDepth + 1);  // never reallocated, so keys handed out stay valid
+    }
+
+    [[noreturn]] void fail(const std::string& what) const {
+        std::string where;
+        for (const auto& part : path_) {
+            if (part.index >= 0) {
+                where += "[" + std::to_string(part.index) + "]";
+            } else {
+                if (!where.empty()) where += ".";
+                where += part.key;
+            }
+        }
+        if (where.empty()) where = "body";
+        throw std::invalid_argument(where + ": " + what + " (at byte " + std::to_string(at_ - begin_) + ")");
+    }
+
+    void skip_space() {
+        while (at_ < end_ && (*at_ == ' ' || *at_ == '\n' || *at_ == '\r' || *at_ == '\t')) at_++;
+    }
+
+    char peek() {
+        skip_space();
+        return at_ < end_ ? *at_ : '\0';
+    }
+
+    void expect(char c, const char* what) {
+        if (peek() != c) fail(std::string("expected ") + what);
+        at_++;
+    }
+
+    bool consume_literal(const char* literal) {
+        size_t n = std::strlen(literal);
+        if (static_cast<size_t>(end_ - at_) < n || std::memcmp(at_, literal, n) != 0) return false;
+        at_ += n;
+        return true;
+    }
+
+    // null is accepted wherever the model has Optional[...] = None
+    bool consume_null() {
+        return peek() == 'n' && consume_literal("null");
+    }
+
+    // Walk an array, calling element(i) with the cursor on each element
+    template <class F>
+    void read_array(F&& element) {
+        expect('[', "an array");
+        if (peek() == ']') {
+            at_++;
+            return;
+        }
+        for (int i = 0;; i++) {
+            if (!skipping_) path_.push_back({nullptr, i});
+            element(i);
+            if (!skipping_) path_.pop_back();
+            char c = peek();
+            if (c == ',') {
+                at_++;
+            } else if (c == ']') {
+                at_++;
+                return;
+            } else {
+                fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    // Walk an object, calling field(key) with the cursor on each value. The
+    // key is only valid during the call.
+    template <class F>
+    void read_object(F&& field) {
+        expect('{', "an object");
+        if (depth_ == kMaxDepth) fail("nested too deeply");
+        std::string& key = keys_[depth_++];
+        if (peek() == '}') {
+            at_++;
+            depth_--;
+            return;
+        }
+        while (true) {
+            if (peek() != '"') fail("expected a field name");
+            key.clear();
+            read_string(key);
+            expect(':', "':'");
+            field(std::string_view(key));
+            char c = peek();
+            if (c == ',') {
+                at_++;
+            } else if (c == '}') {
+                at_++;
+                depth_--;
+                return;
+            } else {
+                fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    static void append_utf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xc0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xe0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            out += static_cast<char>(0xf0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            out += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    uint32_t read_hex4() {
+        if (end_ - at_ < 4) fail("truncated \\u escape");
+        uint32_t code = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = *at_++;
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else fail("bad \\u escape");
+        }
+        return code;
+    }
+
+    // Append the decoded string at the cursor to out. Plain runs are copied
+    // a word at a time; only escapes go byte by byte.
+    void read_string(std::string& out) {
+        if (peek() != '"') fail("expected a string");
+        at_++;
+        while (true) {
+            const char* run = at_;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            while (end_ - at_ >= 8) {
+                uint64_t word;
+                std::memcpy(&word, at_, 8);
+                uint64_t found = json_special_bytes(word);
+                if (found != 0) {
+                    at_ += lowest_bit(found) >> 3;
+                    break;
+                }
+                at_ += 8;
+            }
+#endif
+            while (at_ < end_ && *at_ != '"' && *at_ != '\\' && static_cast<unsigned char>(*at_) >= 0x20) at_++;
+            out.append(run, at_ - run);
+            if (at_ == end_) fail("unterminated string");
+
+            char c = *at_++;
+            if (c == '"') return;
+            if (c != '\\') {
+                at_--;
+                fail("control character in string");
+            }
+            if (at_ == end_) fail("unterminated string");
+            switch (*at_++) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    uint32_t code = read_hex4();
+                    if (code >= 0xd800 && code < 0xdc00) {
+                        if (!consume_literal("\\u")) fail("unpaired surrogate");
+                        uint32_t low = read_hex4();
+                        if (low < 0xdc00 || low >= 0xe000) fail("unpaired surrogate");
+                        code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                    } else if (code >= 0xdc00 && code < 0xe000) {
+                        fail("unpaired surrogate");
+                    }
+                    append_utf8(out, code);
+                    break;
+                }
+                default:
+                    fail("bad escape in string");
+            }
+        }
+    }
+
+    std::string read_string() {
+        std::string out;
+        read_string(out);
+        return out;
+    }
+
+    // Integers, and numbers like 3.0 with no fractional part, in [lo, hi]
+    long long read_int(long long lo, long long hi) {
+        skip_space();
+        const char* start = at_;
+        if (at_ < end_ && *at_ == '-') at_++;
+        if (at_ == end_ || *at_ < '0' || *at_ > '9') fail("expected an integer");
+        long long value = 0;
+        bool overflow = false;
+        while (at_ < end_ && *at_ >= '0' && *at_ <= '9') {
+            if (value > (LLONG_MAX - 9) / 10) overflow = true;
+            else value = value * 10 + (*at_ - '0');
+            at_++;
+        }
+        if (*start == '-') value = -value;
+        if (at_ < end_ && (*at_ == '.' || *at_ == 'e' || *at_ == 'E')) {
+            while (at_ < end_ && (std::strchr("0123456789.eE+-", *at_) != nullptr)) at_++;
+            std::string text(start, at_);
+            char* stop = nullptr;
+            double number = std::strtod(text.c_str(), &stop);
+            if (stop != text.c_str() + text.size() || number != std::floor(number)) fail("expected an integer");
+            if (number < static_cast<double>(lo) || number > static_cast<double>(hi)) overflow = true;
+            else value = static_cast<long long>(number);
+        }
+        if (overflow || value < lo || value > hi) {
+            fail("must be between " + std::to_string(lo) + " and " + std::to_string(hi));
+        }
+        return value;
+    }
+
+    int read_int32(int lo, int hi) { return static_cast<int>(read_int(lo, hi)); }
+
+    bool read_bool() {
+        skip_space();
+        if (consume_literal("true")) return true;
+        if (consume_literal("false")) return false;
+        char c = peek();
+        if (c == '0' || c == '1') return read_int(0, 1) == 1;
+        fail("expected a boolean");
+    }
+
+    // Check and step over a value of a field the model does not have
+    void skip_value(int depth = 0) {
+        if (depth > kMaxDepth) fail("nested too deeply");
+        skipping_++;
+        char c = peek();
+        if (c == '{') {
+            read_object([&](std::string_view) { skip_value(depth + 1); });
+        } else if (c == '[') {
+            read_array([&](int) { skip_value(depth + 1); });
+        } else if (c == '"') {
+            skipped_.clear();
+            read_string(skipped_);
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            while (at_ < end_ && std::strchr("0123456789.eE+-", *at_) != nullptr) at_++;
+        } else if (!consume_literal("true") && !consume_literal("false") && !consume_literal("null")) {
+            fail("expected a value");
+        }
+        skipping_--;
+    }
+
+    // Runs f with the field on the error path
+    template <class F>
+    void in_field(const char* name, F&& f) {
+        path_.push_back({name, -1});
+        f();
+        path_.pop_back();
+    }
+
+    void read_student(RequestStudents& students) {
+        // Required fields, one bit each in declaration order
+        static const char* const names[] = {"file_number", "name", "major", "examination_date", "course_code",
+                                            "course_name", "language", "academic_year", "time"};
+        TextColumn* columns[] = {nullptr, &students.name, &students.major, &students.examination_date,
+                                 &students.course_code, &students.course_name, &students.language,
+                                 &students.academic_year, &students.time};
+        unsigned seen = 0;
+        read_object([&](std::string_view key) {
+            int field = -1;
+            for (int f = 0; f < 9; f++) {
+                if (key == names[f]) field = f;
+            }
+            if (field < 0) {
+                skip_value();
+                return;
+            }
+            in_field(names[field], [&] {
+                if (seen & (1u << field)) fail("given twice");
+                seen |= 1u << field;
+                if (field == 0) {
+                    students.file_number.push_back(read_int32(INT32_MIN, INT32_MAX));
+                    return;
+                }
+                std::string& buffer = columns[field]->buffer();
+                size_t start = buffer.size();
+                read_string(buffer);
+                if (field == 3 && !is_iso_date(std::string_view(buffer).substr(start))) {
+                    fail("expected a date as YYYY-MM-DD");
+                }
+                columns[field]->close();
+            });
+        });
+        for (int f = 0; f < 9; f++) {
+            if (!(seen & (1u << f))) fail(std::string("missing field ") + names[f]);
+        }
+    }
+
+    std::pair<int, int> read_pair(int lo, int hi) {
+        std::pair<int, int> pair;
+        int count = 0;
+        read_array([&](int i) {
+            int value = read_int32(lo, hi);
+            if (i == 0) pair.first = value;
+            if (i == 1) pair.second = value;
+            count++;
+        });
+        if (count != 2) fail("expected a pair of integers");
+        return pair;
+    }
+
+    RequestRoom read_room() {
+        RequestRoom room;
+        unsigned seen = 0;
+        read_object([&](std::string_view key) {
+            if (key == "room_id") {
+                in_field("room_id", [&] { room.room_id = read_string(); });
+                seen |= 1;
+            } else if (key == "rows") {
+                in_field("rows", [&] { room.rows = read_int32(0, kMaxRoomSide); });
+                seen |= 2;
+            } else if (key == "cols") {
+                in_field("cols", [&] { room.cols = read_int32(0, kMaxRoomSide); });
+                seen |= 4;
+            } else if (key == "skip_rows") {
+                in_field("skip_rows", [&] { room.skip_rows = read_bool(); });
+                seen |= 8;
+            } else if (key == "skip_cols") {
+                in_field("skip_cols", [&] { room.skip_cols = read_int32(0, kMaxRoomSide); });
+                seen |= 16;
+            } else if (key == "seat_mask") {
+                in_field("seat_mask", [&] {
+                    room.seat_mask.clear();
+                    if (consume_null()) return;
+                    read_array([&](int) {
+                        room.seat_mask.push_back(read_string());
+                        if (room.seat_mask.back().size() > static_cast<size_t>(kMaxRoomSide)) fail("row is too long");
+                    });
+                    if (room.seat_mask.size() > static_cast<size_t>(kMaxRoomSide)) fail("too many rows");
+                });
+            } else if (key == "adjacency") {
+                in_field("adjacency", [&] {
+                    room.adjacency.clear();
+                    if (consume_null()) return;
+                    read_array([&](int) { room.adjacency.push_back(read_pair(0, INT32_MAX)); });
+                });
+            } else {
+                skip_value();
+            }
+        });
+        static const char* const required[] = {"room_id", "rows", "cols", "skip_rows", "skip_cols"};
+        for (int f = 0; f < 5; f++) {
+            if (!(seen & (1u << f))) fail(std::string("missing field ") + required[f]);
+        }
+        return room;
+    }
+
+    Separation read_separation() {
+        Separation separation;
+        read_object([&](std::string_view key) {
+            if (key == "kind") {
+                in_field("kind", [&] {
+                    if (consume_null()) return;
+                    separation.kind = read_string();
+                    if (separation.kind != "von_neumann" && separation.kind != "moore" && separation.kind != "custom") {
+                        fail("expected von_neumann, moore or custom");
+                    }
+                });
+            } else if (key == "radius") {
+                in_field("radius", [&] { separation.radius = read_int32(0, kMaxRadius); });
+            } else if (key == "offsets") {
+                in_field("offsets", [&] {
+                    separation.offsets.clear();
+                    if (consume_null()) return;
+                    read_array([&](int) { separation.offsets.push_back(read_pair(-kMaxRoomSide, kMaxRoomSide)); });
+                });
+            } else {
+                skip_value();
+            }
+        });
+        return separation;
+    }
+
+    RequestPin read_pin() {
+        RequestPin pin;
+        unsigned seen = 0;
+        read_object([&](std::string_view key) {
+            if (key == "file_number") {
+                in_field("file_number", [&] { pin.file_number = read_int32(INT32_MIN, INT32_MAX); });
+                seen |= 1;
+            } else if (key == "room_id") {
+                in_field("room_id", [&] { pin.room_id = read_string(); });
+                seen |= 2;
+            } else if (key == "row") {
+                in_field("row", [&] { pin.row = consume_null() ? -1 : read_int32(0, kMaxRoomSide); });
+            } else if (key == "col") {
+                in_field("col", [&] { pin.col = consume_null() ? -1 : read_int32(0, kMaxRoomSide); });
+            } else {
+                skip_value();
+            }
+        });
+        if (!(seen & 1)) fail("missing field file_number");
+        if (!(seen & 2)) fail("missing field room_id");
+        if ((pin.row < 0) != (pin.col < 0)) fail("row and col must be given together");
+        return pin;
+    }
+
+    AssignRequestData read_request() {
+        AssignRequestData request;
+        bool has_students = false, has_rooms = false;
+        read_object([&](std::string_view key) {
+            if (key == "students") {
+                has_students = true;
+                in_field("students", [&] { read_array([&](int) { read_student(request.students); }); });
+            } else if (key == "rooms") {
+                has_rooms = true;
+                in_field("rooms", [&] { read_array([&](int) { request.rooms.push_back(read_room()); }); });
+            } else if (key == "exam_room_restrictions") {
+                in_field("exam_room_restrictions", [&] {
+                    request.restrictions.clear();
+                    if (consume_null()) return;
+                    read_object([&](std::string_view exam) {
+                        auto& room_ids = request.restrictions[std::string(exam)];
+                        room_ids.clear();
+                        read_array([&](int) { room_ids.push_back(read_string()); });
+                    });
+                });
+            } else if (key == "separation") {
+                in_field("separation", [&] {
+                    if (consume_null()) request.separation.reset();
+                    else request.separation = read_separation();
+                });
+            } else if (key == "pins") {
+                in_field("pins", [&] {
+                    request.pins.clear();
+                    if (consume_null()) return;
+                    read_array([&](int) { request.pins.push_back(read_pin()); });
+                });
+            } else {
+                skip_value();
+            }
+        });
+        if (!has_students) fail("missing field students");
+        if (!has_rooms) fail("missing field rooms");
+        if (peek() != '\0' || at_ != end_) fail("unexpected data after the request");
+        return request;
+    }
+
+public:
+    static AssignRequestData parse(std::string_view body) {
+        AssignRequestParser parser(body);
+        return parser.read_request();
+    }
+};
+
+inline AssignRequestData parse_assign_request(std::string_view body) {
+    auto start = std::chrono::steady_clock::now();
+    AssignRequestData request = AssignRequestParser::parse(body);
+    request.parse_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return request;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "bits.h"
+#include "request_json.h"
+
+// AssignResponse body, {"assignments": [AssignmentWithStudentOut, ...]},
+// written straight from the parsed request's student columns and the
+// solver's assignments. The buffer is sized once from the column sizes, so
+// a large session is serialised without reallocating or creating any
+// per-student Python objects.
+
+class JsonWriter {
+private:
+    std::string& out_;
+
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    void raw(std::string_view text) { out_.append(text); }
+
+    void integer(long long value) {
+        char digits[24];
+        auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        out_.append(digits, end - digits);
+    }
+
+    // Quoted and escaped; UTF-8 passes through. Plain runs are found eight
+    // bytes at a time and copied in one append.
+    void string(std::string_view text) {
+        static const char hex[] = "0123456789abcdef";
+        out_ += '"';
+        const char* at = text.data();
+        const char* end = at + text.size();
+        while (at < end) {
+            const char* run = at;
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            while (end - at >= 8) {
+                uint64_t word;
+                std::memcpy(&word, at, 8);
+                uint64_t found = json_special_bytes(word);
+                if (found != 0) {
+                    at += lowest_bit(found) >> 3;
+                    break;
+                }
+                at += 8;
+            }
+#endif
+            while (at < end && *at != '"' && *at != '\\' && static_cast<unsigned char>(*at) >= 0x20) at++;
+            out_.append(run, at - run);
+            if (at == end) break;
+
+            unsigned char c = static_cast<unsigned char>(*at++);
+            switch (c) {
+                case '"': out_ += "\\\""; break;
+                case '\\': out_ += "\\\\"; break;
+                case '\n': out_ += "\\n"; break;
+                case '\r': out_ += "\\r"; break;
+                case '\t': out_ += "\\t"; break;
+                case '\b': out_ += "\\b"; break;
+                case '\f': out_ += "\\f"; break;
+                default:
+                    out_ += "\\u00";
+                    out_ += hex[c >> 4];
+                    out_ += hex[c & 15];
+            }
+        }
+        out_ += '"';
+    }
+
+    // "name": prefix of an object member, with the separator before it
+    void key(std::string_view name, bool first) {
+        if (!first) out_ += ',';
+        out_ += '"';
+        out_.append(name);
+        out_ += "\":";
+    }
+};
+
+// Assignments are written in the order given. Each names its student by
+// file number; a file number missing from the request throws
+// std::invalid_argument.
+template <class AssignmentT>
+std::string assign_response_json(const RequestStudents& students, const std::vector<AssignmentT>& assignments) {
+    std::unordered_map<int32_t, uint32_t> row_of;
+    row_of.reserve(students.size());
+    for (size_t i = 0; i < students.size(); i++) {
+        row_of.emplace(students.file_number[i], static_cast<uint32_t>(i));
+    }
+
+    // Field text, plus keys, punctuation and numbers at under 224 bytes a
+    // record; escapes are rare enough to leave to the string's own growth
+    size_t text = students.name.bytes() + students.major.bytes() + students.examination_date.bytes() +
+                  students.course_code.bytes() + students.course_name.bytes() + students.language.bytes() +
+                  students.academic_year.bytes() + students.time.bytes();
+    size_t room_text = 0;
+    for (const auto& assignment : assignments) room_text += assignment.room_id.size();
+    std::string out;
+    out.reserve(32 + text + room_text + assignments.size() * 224);
+
+    JsonWriter json(out);
+    json.raw("{\"assignments\":[");
+    bool first_record = true;
+    for (const auto& assignment : assignments) {
+        auto found = row_of.find(assignment.student_id);
+        if (found == row_of.end()) {
+            throw std::invalid_argument("Assignment for student " + std::to_string(assignment.student_id) +
+                                        " who is not in the request");
+        }
+        size_t i = found->second;
+        if (!first_record) json.raw(",");
+        first_record = false;
+
+        json.raw("{");
+        json.key("file_number", true);
+        json.integer(students.file_number[i]);
+        json.key("name", false);
+        json.string(students.name[i]);
+        json.key("major", false);
+        json.string(students.major[i]);
+        json.key("examination_date", false);
+        json.string(students.examination_date[i]);
+        json.key("course_code", false);
+        json.string(students.course_code[i]);
+        json.key("course_name", false);
+        json.string(students.course_name[i]);
+        json.key("language", false);
+        json.string(students.language[i]);
+        json.key("academic_year", false);
+        json.string(students.academic_year[i]);
+        json.key("time", false);
+        json.string(students.time[i]);
+        json.key("room_id", false);
+        json.string(assignment.room_id);
+        json.key("row", false);
+        json.integer(assignment.row);
+        json.key("col", false);
+        json.integer(assignment.col);
+        json.raw("}");
+    }
+    json.raw("]}");
+    return out;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Which seats count as neighbours of a seat. Two students of the same exam
+// may never sit on neighbouring seats.
+//   "von_neumann": |dr| + |dc| <= radius (radius 1 is the classic left/right/front/back)
+//   "moore":       max(|dr|, |dc|) <= radius (radius 1 adds the diagonals)
+//   "custom":      the (dr, dc) offsets listed, mirrored so the relation is symmetric
+struct Separation {
+    std::string kind = "von_neumann";
+    int radius = 1;
+    std::vector<std::pair<int, int>> offsets;  // custom stencil only
+
+    Separation() = default;
+    Separation(const std::string& k, int r) : kind(k), radius(r) {}
+    Separation(const std::vector<std::pair<int, int>>& o) : kind("custom"), radius(0), offsets(o) {}
+};
+
+// Forward half of the stencil: offsets with dr > 0, or dr == 0 and dc > 0.
+// Walking these from every seat visits each neighbouring pair exactly once,
+// so neighbour tables are built in O(seats * stencil) without a pair scan.
+inline std::vector<std::pair<int, int>> forward_stencil(const Separation& separation) {
+    std::vector<std::pair<int, int>> stencil;
+    auto add = [&](int dr, int dc) {
+        if (dr < 0 || (dr == 0 && dc < 0)) {
+            dr = -dr;
+            dc = -dc;
+        }
+        if (dr != 0 || dc != 0) stencil.push_back({dr, dc});
+    };
+
+    if (separation.kind == "custom") {
+        for (const auto& offset : separation.offsets) add(offset.first, offset.second);
+    } else if (separation.kind == "von_neumann" || separation.kind == "moore") {
+        if (separation.radius < 0) {
+            throw std::invalid_argument("Separation radius must be non-negative");
+        }
+        int r = separation.radius;
+        for (int dr = 0; dr <= r; dr++) {
+            for (int dc = -r; dc <= r; dc++) {
+                if (separation.kind == "moore" || dr + std::abs(dc) <= r) add(dr, dc);
+            }
+        }
+    } else {
+        throw std::invalid_argument("Unknown separation kind: " + separation.kind);
+    }
+
+    std::sort(stencil.begin(), stencil.end());
+    stencil.erase(std::unique(stencil.begin(), stencil.end()), stencil.end());
+    return stencil;
+}
+
+inline std::string describe(const Separation& separation) {
+    if (separation.kind == "custom") {
+        return "custom stencil of " + std::to_string(separation.offsets.size()) + " offsets";
+    }
+    return separation.kind + " radius " + std::to_string(separation.radius);
+}
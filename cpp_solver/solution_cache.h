@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Solved instances are remembered under a 128-bit hash of their canonical
+// form, so a resubmitted request is answered without solving. The caller
+// feeds the hasher in canonical order (students by ID, rooms by ID, sorted
+// restrictions); the cache itself knows nothing about the problem.
+
+struct InstanceKey {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    bool operator==(const InstanceKey& other) const { return hi == other.hi && lo == other.lo; }
+
+    std::string hex() const {
+        char buffer[33];
+        std::snprintf(buffer, sizeof(buffer), "%016llx%016llx",
+                      static_cast<unsigned long long>(hi), static_cast<unsigned long long>(lo));
+        return buffer;
+    }
+};
+
+struct InstanceKeyHash {
+    size_t operator()(const InstanceKey& key) const { return static_cast<size_t>(key.lo ^ key.hi); }
+};
+
+// Two independent 64-bit lanes (FNV-1a and a splitmix64 chain). Strings are
+// length-prefixed, so field boundaries cannot be shifted to forge a collision.
+class KeyHasher {
+private:
+    uint64_t a_ = 0xcbf29ce484222325ULL;
+    uint64_t b_ = 0x9e3779b97f4a7c15ULL;
+
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    KeyHasher& add(uint64_t value) {
+        for (int i = 0; i < 8; i++) {
+            a_ = (a_ ^ ((value >> (8 * i)) & 0xff)) * 0x100000001b3ULL;
+        }
+        b_ = mix(b_ + value + 0x9e3779b97f4a7c15ULL);
+        return *this;
+    }
+
+    KeyHasher& add(std::string_view text) {
+        add(static_cast<uint64_t>(text.size()));
+        for (unsigned char c : text) {
+            a_ = (a_ ^ c) * 0x100000001b3ULL;
+            b_ = mix(b_ ^ c);
+        }
+        return *this;
+    }
+
+    InstanceKey key() const { return {mix(a_), b_}; }
+};
+
+// Least-recently-used map with a fixed number of entries, safe to share
+// between optimizers on different threads
+template <class Value>
+class LruCache {
+private:
+    using Entry = std::pair<InstanceKey, Value>;
+    size_t capacity_;
+    std::list<Entry> order_;  // most recently used first
+    std::unordered_map<InstanceKey, typename std::list<Entry>::iterator, InstanceKeyHash> index_;
+    mutable std::mutex mutex_;
+
+    void trim() {
+        while (order_.size() > capacity_) {
+            index_.erase(order_.back().first);
+            order_.pop_back();
+        }
+    }
+
+public:
+    explicit LruCache(size_t capacity) : capacity_(capacity) {}
+
+    std::optional<Value> get(const InstanceKey& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) return std::nullopt;
+        order_.splice(order_.begin(), order_, it->second);
+        return it->second->second;
+    }
+
+    void put(const InstanceKey& key, Value value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            it->second->second = std::move(value);
+            order_.splice(order_.begin(), order_, it->second);
+            return;
+        }
+        order_.emplace_front(key, std::move(value));
+        index_[key] = order_.begin();
+        trim();
+    }
+
+    void set_capacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity;
+        trim();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        order_.clear();
+        index_.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return order_.size();
+    }
+};
+
+// Flat little helpers for the on-disk format: fixed-width integers in host
+// byte order and length-prefixed strings. Cache files are only read back by
+// the machine that wrote them; the solver daemon uses the same layout for
+// its frames and shared-memory instances.
+class ByteWriter {
+private:
+    std::string bytes_;
+
+public:
+    template <class T>
+    void put(T value) {
+        bytes_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void put(const std::string& text) {
+        put(static_cast<uint32_t>(text.size()));
+        bytes_.append(text);
+    }
+
+    const std::string& bytes() const { return bytes_; }
+};
+
+class ByteReader {
+private:
+    std::string_view bytes_;
+    size_t at_ = 0;
+
+public:
+    explicit ByteReader(std::string_view bytes) : bytes_(bytes) {}
+
+    // False once the data ran out; the value is left untouched
+    template <class T>
+    bool get(T& value) {
+        if (bytes_.size() - at_ < sizeof(T)) return false;
+        std::memcpy(&value, bytes_.data() + at_, sizeof(T));
+        at_ += sizeof(T);
+        return true;
+    }
+
+    bool get(std::string& text) {
+        uint32_t size = 0;
+        if (!get(size) || bytes_.size() - at_ < size) return false;
+        text.assign(bytes_.data() + at_, size);
+        at_ += size;
+        return true;
+    }
+
+    // count values of T back to back
+    template <class T>
+    bool get_array(std::vector<T>& values, size_t count) {
+        if (count > (bytes_.size() - at_) / sizeof(T)) return false;
+        values.resize(count);
+        if (count > 0) std::memcpy(values.data(), bytes_.data() + at_, count * sizeof(T));
+        at_ += count * sizeof(T);
+        return true;
+    }
+
+    bool done() const { return at_ == bytes_.size(); }
+};
+
+// One file per instance, <directory>/<key>.sol. Writes go to a temporary
+// file that is renamed into place, so a reader never sees half a file.
+inline std::optional<std::string> load_cache_file(const std::string& directory, const InstanceKey& key) {
+    std::ifstream in(std::filesystem::path(directory) / (key.hex() + ".sol"), std::ios::binary);
+    if (!in) return std::nullopt;
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+inline bool store_cache_file(const std::string& directory, const InstanceKey& key, const std::string& bytes) {
+    std::error_code error;
+    std::filesystem::path dir(directory);
+    std::filesystem::create_directories(dir, error);
+    if (error) return false;
+
+    std::ostringstream suffix;
+    suffix << ".tmp" << std::this_thread::get_id();
+    std::filesystem::path target = dir / (key.hex() + ".sol");
+    std::filesystem::path temporary = dir / (key.hex() + suffix.str());
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) return false;
+    }
+    std::filesystem::rename(temporary, target, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
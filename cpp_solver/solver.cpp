@@ -1,11 +1,42 @@
+// FAST_SOLVER_NO_PYTHON leaves out the bindings, for the solver daemon
+#ifndef FAST_SOLVER_NO_PYTHON
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/functional.h>
+#endif
 #include <vector>
+#include <map>
+#include <tuple>
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
+#include <set>
+#include <stdexcept>
 #include <iostream>
+#include <atomic>
+#include <climits>
+#include <functional>
+#include <optional>
 #include <chrono>
+#include <cmath>
+#include <numeric>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <mutex>
 #include <ortools/sat/cp_model.h>
+#include "bin_packing.h"
+#include "progress.h"
+#include "memory_usage.h"
+#include "problem.h"
+#include "separation.h"
+#include "bitboard.h"
+#include "solution_cache.h"
+#include "request_json.h"
+#include "response_json.h"
+#include "assignment_table.h"
+#include "task_pool.h"
+#include "deadline.h"
 
 using namespace operations_research::sat;
 
@@ -17,14 +48,63 @@ struct Student {
     Student(int i, const std::string& e) : id(i), exam(e) {}
 };
 
+// A room is either a rows x cols grid thinned by skip_rows / skip_cols, or an
+// explicit list of seats (aisles, broken seats, irregular rows) with optional
+// custom adjacency. Both are compiled into the same seat index and neighbour
+// lists, so every engine treats them alike.
 struct Room {
     std::string id;
     int rows, cols;
-    bool skip_rows, skip_cols;
+    bool skip_rows;                              // skip odd rows
+    int skip_cols;                               // 0 none, else columns with c % k == k - 1, k = max(skip_cols, 2)
+    std::vector<std::pair<int, int>> seats;      // explicit (row, col) seats, overrides the grid when set
+    std::vector<std::pair<int, int>> adjacency;  // pairs of indices into seats, empty for grid neighbours
     
     Room() = default;
-    Room(const std::string& i, int r, int c, bool sr, bool sc) 
+    Room(const std::string& i, int r, int c, bool sr, int sc) 
         : id(i), rows(r), cols(c), skip_rows(sr), skip_cols(sc) {}
+    Room(const std::string& i, const std::vector<std::pair<int, int>>& s, 
+         const std::vector<std::pair<int, int>>& adj = {})
+        : id(i), rows(0), cols(0), skip_rows(false), skip_cols(0), seats(s), adjacency(adj) {
+        std::set<std::pair<int, int>> seen;
+        for (const auto& seat : seats) {
+            if (seat.first < 0 || seat.second < 0) {
+                throw std::invalid_argument("Room " + id + ": seat coordinates must be non-negative");
+            }
+            if (!seen.insert(seat).second) {
+                throw std::invalid_argument("Room " + id + ": duplicate seat");
+            }
+            rows = std::max(rows, seat.first + 1);
+            cols = std::max(cols, seat.second + 1);
+        }
+        for (const auto& pair : adjacency) {
+            int n = static_cast<int>(seats.size());
+            if (pair.first < 0 || pair.first >= n || pair.second < 0 || pair.second >= n || pair.first == pair.second) {
+                throw std::invalid_argument("Room " + id + ": adjacency refers to an unknown seat");
+            }
+        }
+    }
+    
+    // One string per row: '.' or ' ' is no seat, any other character is a seat.
+    // Seats are numbered row-major, which is the order adjacency refers to.
+    static Room from_mask(const std::string& i, const std::vector<std::string>& mask, 
+                          const std::vector<std::pair<int, int>>& adj = {}) {
+        std::vector<std::pair<int, int>> seats;
+        for (size_t r = 0; r < mask.size(); r++) {
+            for (size_t c = 0; c < mask[r].size(); c++) {
+                if (mask[r][c] != '.' && mask[r][c] != ' ') {
+                    seats.push_back({static_cast<int>(r), static_cast<int>(c)});
+                }
+            }
+        }
+        return Room(i, seats, adj);
+    }
+    
+    bool column_skipped(int c) const {
+        if (skip_cols <= 0) return false;
+        int stride = std::max(skip_cols, 2);
+        return c % stride == stride - 1;
+    }
 };
 
 struct Assignment {
@@ -32,267 +112,2652 @@ struct Assignment {
     std::string room_id;
     int row, col;
     
-    Assignment() = default;
-    Assignment(int sid, const std::string& rid, int r, int c) 
-        : student_id(sid), room_id(rid), row(r), col(c) {}
-};
-
-class FastSeatingOptimizer {
-private:
-    std::vector<std::vector<std::pair<int, int>>> precompute_positions(const std::vector<Room>& rooms) {
-        std::vector<std::vector<std::pair<int, int>>> room_positions;
+    Assignment() = default;
+    Assignment(int sid, const std::string& rid, int r, int c) 
+        : student_id(sid), room_id(rid), row(r), col(c) {}
+};
+
+// A student held to one seat (row and col set) or one room (row = col = -1).
+// Several pins of the same student list the rooms and seats that student may
+// take; one of them is chosen before the rest of the request is solved.
+// Pins take precedence over the exam's room restrictions.
+struct Pin {
+    int student_id;
+    std::string room_id;
+    int row = -1, col = -1;
+    
+    Pin() = default;
+    Pin(int sid, const std::string& rid, int r = -1, int c = -1) 
+        : student_id(sid), room_id(rid), row(r), col(c) {}
+};
+
+struct RoomPlanEntry {
+    std::string exam;
+    std::string room_id;
+    int count;
+    
+    RoomPlanEntry() = default;
+    RoomPlanEntry(const std::string& e, const std::string& rid, int c) 
+        : exam(e), room_id(rid), count(c) {}
+};
+
+// Result of the room-level packing stage
+struct RoomPlan {
+    std::vector<RoomPlanEntry> entries;
+    std::vector<Assignment> assignments; // plan realised seat by seat, empty if incomplete
+    int rooms_used = 0;
+    int lower_bound = 0;                 // certified minimum rooms, -1 if no seating exists
+    bool complete = false;
+    std::string method;
+};
+
+struct SolveOptions {
+    std::string mode = "auto";  // "auto", "packing", "greedy" or "cpsat"
+    int timeout_seconds = 120;
+    int accept_gap = 0;         // stop searching once rooms_used - lower_bound <= accept_gap
+    // Called from the solver thread on every improving solution
+    std::function<void(const ProgressUpdate&)> on_progress;
+    // CP-SAT formulation: "student" (one variable per student and seat), "exam"
+    // (one per exam and seat, students handed out afterwards) or "auto" (exam)
+    std::string formulation = "auto";
+    // Greedy restarts run in parallel; start j orders exams, rooms and seats
+    // from seed + j, and seed 0 is the deterministic largest-first order.
+    // Rerunning with seed = SolveResult::seed and one start reproduces a result.
+    int greedy_starts = 1;
+    uint64_t seed = 0;
+    int num_threads = 0;        // parallel greedy starts or components, 0: the whole task pool
+    // Ceiling for the CP-SAT model in MB, 0 for none. Falls back from the
+    // student to the exam formulation, then to the packing plan alone.
+    int memory_limit_mb = 0;
+    // Neighbour rule for same-exam students, applied to every room without
+    // explicit adjacency
+    Separation separation;
+    // Secondary CP-SAT objective, below the room count: spread_weight per room
+    // an exam is split over, balance_weight per percentage point of the
+    // fullest room's fill. 0 and 0 minimise rooms only. With either set, auto
+    // mode always runs CP-SAT and accept_gap no longer cuts the search short.
+    int spread_weight = 0;
+    int balance_weight = 0;
+    // "eager" adds every same-exam neighbour constraint to the CP-SAT model up
+    // front. "lazy" solves without them, adds only the pairs the solution
+    // violates, and re-solves from that solution until none are left.
+    std::string separation_mode = "eager";
+    // Students with fixed seats or their own room / seat choices, see Pin
+    std::vector<Pin> pins;
+    // Solve independent components (exams confined to disjoint room sets by
+    // their restrictions) separately and in parallel
+    bool decompose = true;
+    // Answer a resubmitted instance from the solution cache, and start CP-SAT
+    // from the last seating of the same rooms when only students changed
+    bool use_cache = true;
+};
+
+struct SolveResult {
+    std::vector<Assignment> assignments;
+    std::string engine;         // engine that produced the assignments
+    std::string status = "unknown"; // "optimal", "feasible", "infeasible", "invalid" or "unknown"
+    int rooms_used = 0;
+    int lower_bound = 0;        // certified minimum number of rooms
+    int gap = 0;                // rooms_used - lower_bound, 0 means proven optimal
+    bool valid = false;         // passed the native verifier
+    long long solve_ms = 0;
+    std::string formulation;    // CP-SAT formulation solved, empty if CP-SAT did not run
+    long long model_variables = 0;
+    double peak_rss_mb = 0;     // process peak resident set size
+    uint64_t seed = 0;          // seed of the greedy start behind the assignments
+    int exam_rooms = 0;         // (exam, room) pairs used: invigilator handouts
+    int max_fill_percent = 0;   // fill of the fullest room used
+    bool cached = false;        // answered from the solution cache
+    std::string instance_key;   // canonical hash of the request, empty if the cache is off
+};
+
+// Rooms with the same grid parameters, or the same explicit seats and
+// adjacency, have identical seat geometry, so the packed seat index and the
+// neighbour graph are compiled once per shape class.
+struct RoomShape {
+    int rows, cols;
+    bool skip_rows;
+    int skip_cols;
+    bool custom;                                     // explicit seat list
+    std::vector<std::pair<int, int>> positions;      // packed seat index -> (row, col)
+    std::vector<std::pair<int, int>> adjacent_pairs; // indices into positions, first < second
+    std::vector<int> neighbour_offset;               // CSR: neighbours of seat i are
+    std::vector<int> neighbours;                     //   neighbours[neighbour_offset[i] .. neighbour_offset[i + 1])
+    std::vector<int> cell;                           // row * cols + col -> position index, -1 if no seat
+    BoardLayout board;                               // bitboard geometry for seat search and verification
+    std::vector<int> rooms;                          // room indices with this shape
+};
+
+// Solved instances shared by every optimizer in the process. Full requests
+// are keyed by instance_key(); warm entries keep the last seating per room
+// set (rooms, restrictions and separation) as CP-SAT hints for requests that
+// differ only in their students. Solved entries are also written to the
+// cache directory when one is set (configure_cache or FAST_SOLVER_CACHE_DIR).
+struct CachedSolve {
+    SolveResult result;
+    int timeout_seconds = 0;  // budget the result was found with
+};
+
+struct SolutionCache {
+    LruCache<CachedSolve> solved{64};
+    LruCache<std::vector<Assignment>> warm{64};
+    std::atomic<long long> hits{0};
+    std::atomic<long long> misses{0};
+    std::mutex directory_mutex;
+    std::string directory;
+    
+    SolutionCache() {
+        const char* env = std::getenv("FAST_SOLVER_CACHE_DIR");
+        if (env != nullptr) directory = env;
+    }
+    
+    std::string cache_directory() {
+        std::lock_guard<std::mutex> lock(directory_mutex);
+        return directory;
+    }
+};
+
+inline SolutionCache& solution_cache() {
+    static SolutionCache cache;
+    return cache;
+}
+
+// Rooms by ID, restrictions by exam with sorted room lists, then the
+// separation rule: everything a seating depends on except the students
+inline void hash_layout(
+    KeyHasher& hasher,
+    const std::vector<Room>& rooms,
+    const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+    const Separation& separation
+) {
+    std::vector<const Room*> by_id;
+    for (const auto& room : rooms) by_id.push_back(&room);
+    std::sort(by_id.begin(), by_id.end(), [](const Room* a, const Room* b) {
+        return std::tie(a->id, a->rows, a->cols, a->skip_rows, a->skip_cols, a->seats, a->adjacency) <
+               std::tie(b->id, b->rows, b->cols, b->skip_rows, b->skip_cols, b->seats, b->adjacency);
+    });
+    hasher.add(static_cast<uint64_t>(by_id.size()));
+    for (const Room* room : by_id) {
+        hasher.add(room->id).add(room->rows).add(room->cols).add(room->skip_rows).add(room->skip_cols);
+        hasher.add(static_cast<uint64_t>(room->seats.size()));
+        for (const auto& seat : room->seats) hasher.add(seat.first).add(seat.second);
+        hasher.add(static_cast<uint64_t>(room->adjacency.size()));
+        for (const auto& pair : room->adjacency) hasher.add(pair.first).add(pair.second);
+    }
+    
+    std::vector<std::pair<std::string_view, std::vector<std::string_view>>> sorted;
+    for (const auto& restriction : restrictions) {
+        std::vector<std::string_view> allowed(restriction.second.begin(), restriction.second.end());
+        std::sort(allowed.begin(), allowed.end());
+        allowed.erase(std::unique(allowed.begin(), allowed.end()), allowed.end());
+        sorted.emplace_back(restriction.first, std::move(allowed));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    hasher.add(static_cast<uint64_t>(sorted.size()));
+    for (const auto& restriction : sorted) {
+        hasher.add(restriction.first).add(static_cast<uint64_t>(restriction.second.size()));
+        for (auto room_id : restriction.second) hasher.add(room_id);
+    }
+    
+    hasher.add(separation.kind).add(separation.radius).add(static_cast<uint64_t>(separation.offsets.size()));
+    for (const auto& offset : separation.offsets) hasher.add(offset.first).add(offset.second);
+}
+
+inline InstanceKey layout_key(
+    const std::vector<Room>& rooms,
+    const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+    const SolveOptions& options
+) {
+    KeyHasher hasher;
+    hash_layout(hasher, rooms, restrictions, options.separation);
+    return hasher.key();
+}
+
+// Canonical hash of a request: students sorted by ID, the layout, and the
+// options that change which seating comes back. Time and memory budgets are
+// left out; a cached result is only reused within the budget it was found with.
+inline InstanceKey instance_key(
+    const std::vector<Student>& students,
+    const std::vector<Room>& rooms,
+    const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+    const SolveOptions& options
+) {
+    std::vector<std::pair<int, std::string_view>> by_id;
+    by_id.reserve(students.size());
+    for (const auto& student : students) by_id.emplace_back(student.id, student.exam);
+    std::sort(by_id.begin(), by_id.end());
+    
+    KeyHasher hasher;
+    hasher.add(static_cast<uint64_t>(by_id.size()));
+    for (const auto& student : by_id) hasher.add(static_cast<uint64_t>(student.first)).add(student.second);
+    hash_layout(hasher, rooms, restrictions, options.separation);
+    hasher.add(options.mode).add(options.formulation).add(options.accept_gap);
+    hasher.add(options.greedy_starts).add(options.seed);
+    hasher.add(options.spread_weight).add(options.balance_weight);
+    hasher.add(options.separation_mode);
+    
+    std::vector<std::tuple<int, std::string_view, int, int>> pins;
+    for (const auto& pin : options.pins) pins.emplace_back(pin.student_id, pin.room_id, pin.row, pin.col);
+    std::sort(pins.begin(), pins.end());
+    pins.erase(std::unique(pins.begin(), pins.end()), pins.end());
+    hasher.add(static_cast<uint64_t>(pins.size()));
+    for (const auto& pin : pins) {
+        hasher.add(static_cast<uint64_t>(std::get<0>(pin))).add(std::get<1>(pin)).add(std::get<2>(pin)).add(std::get<3>(pin));
+    }
+    return hasher.key();
+}
+
+// On-disk form of a cached solve. Room IDs are written once and referenced
+// by index from the assignments.
+constexpr uint32_t CACHE_FILE_MAGIC = 0x31435346;  // "FSC1"
+
+inline std::string encode_cached(const CachedSolve& cached) {
+    const SolveResult& r = cached.result;
+    ByteWriter out;
+    out.put(CACHE_FILE_MAGIC);
+    out.put(static_cast<int32_t>(cached.timeout_seconds));
+    out.put(r.engine);
+    out.put(r.status);
+    out.put(r.formulation);
+    out.put(static_cast<int32_t>(r.rooms_used));
+    out.put(static_cast<int32_t>(r.lower_bound));
+    out.put(static_cast<int32_t>(r.gap));
+    out.put(static_cast<int64_t>(r.model_variables));
+    out.put(r.seed);
+    out.put(static_cast<int32_t>(r.exam_rooms));
+    out.put(static_cast<int32_t>(r.max_fill_percent));
+    
+    std::unordered_map<std::string_view, uint32_t> room_index;
+    std::vector<std::string_view> room_names;
+    for (const auto& a : r.assignments) {
+        if (room_index.emplace(a.room_id, static_cast<uint32_t>(room_names.size())).second) {
+            room_names.push_back(a.room_id);
+        }
+    }
+    out.put(static_cast<uint32_t>(room_names.size()));
+    for (auto name : room_names) out.put(std::string(name));
+    out.put(static_cast<uint32_t>(r.assignments.size()));
+    for (const auto& a : r.assignments) {
+        out.put(static_cast<int32_t>(a.student_id));
+        out.put(room_index[a.room_id]);
+        out.put(static_cast<int32_t>(a.row));
+        out.put(static_cast<int32_t>(a.col));
+    }
+    return out.bytes();
+}
+
+// nullopt for a truncated, foreign or corrupt file
+inline std::optional<CachedSolve> decode_cached(const std::string& bytes) {
+    ByteReader in(bytes);
+    CachedSolve cached;
+    SolveResult& r = cached.result;
+    uint32_t magic = 0;
+    int32_t timeout = 0, rooms_used = 0, lower_bound = 0, gap = 0, exam_rooms = 0, max_fill = 0;
+    int64_t model_variables = 0;
+    if (!in.get(magic) || magic != CACHE_FILE_MAGIC) return std::nullopt;
+    if (!in.get(timeout) || !in.get(r.engine) || !in.get(r.status) || !in.get(r.formulation) ||
+        !in.get(rooms_used) || !in.get(lower_bound) || !in.get(gap) || !in.get(model_variables) ||
+        !in.get(r.seed) || !in.get(exam_rooms) || !in.get(max_fill)) {
+        return std::nullopt;
+    }
+    
+    uint32_t num_rooms = 0, num_assignments = 0;
+    if (!in.get(num_rooms)) return std::nullopt;
+    std::vector<std::string> room_names(num_rooms);
+    for (auto& name : room_names) {
+        if (!in.get(name)) return std::nullopt;
+    }
+    if (!in.get(num_assignments)) return std::nullopt;
+    for (uint32_t i = 0; i < num_assignments; i++) {
+        int32_t student_id = 0, row = 0, col = 0;
+        uint32_t room = 0;
+        if (!in.get(student_id) || !in.get(room) || !in.get(row) || !in.get(col) || room >= num_rooms) {
+            return std::nullopt;
+        }
+        r.assignments.emplace_back(student_id, room_names[room], row, col);
+    }
+    if (!in.done()) return std::nullopt;
+    
+    cached.timeout_seconds = timeout;
+    r.rooms_used = rooms_used;
+    r.lower_bound = lower_bound;
+    r.gap = gap;
+    r.model_variables = model_variables;
+    r.exam_rooms = exam_rooms;
+    r.max_fill_percent = max_fill;
+    r.valid = true;  // only verified results are cached
+    return cached;
+}
+
+class FastSeatingOptimizer {
+private:
+    ProgressSlot progress_;
+    std::atomic<bool> stop_requested_{false};
+    std::atomic<bool> cancelled_{false};
+    std::mutex components_mutex_;
+    std::vector<FastSeatingOptimizer*> components_;  // solvers of the components in flight, for stop()
+    
+    // Initial block of the per-solve arena; it grows geometrically from there
+    static size_t arena_bytes(size_t num_students, size_t num_rooms) {
+        return (64 << 10) + 64 * num_students + 256 * num_rooms;
+    }
+    
+    RoomShape compile_shape(const Room& room, const std::vector<std::pair<int, int>>& stencil) {
+        RoomShape shape;
+        shape.rows = std::max(room.rows, 0);
+        shape.cols = std::max(room.cols, 0);
+        shape.skip_rows = room.skip_rows;
+        shape.skip_cols = room.skip_cols;
+        shape.custom = !room.seats.empty();
+        
+        // Packed seat index: grid seats row-major, explicit seats in the given order
+        if (shape.custom) {
+            shape.positions = room.seats;
+        } else {
+            for (int r = 0; r < shape.rows; r++) {
+                if (room.skip_rows && r % 2 != 0) continue;
+                for (int c = 0; c < shape.cols; c++) {
+                    if (room.column_skipped(c)) continue;
+                    shape.positions.push_back({r, c});
+                }
+            }
+        }
+        
+        // Grid cell -> position index, used to find neighbours without a pair scan
+        auto& cell = shape.cell;
+        cell.assign(static_cast<size_t>(shape.rows) * shape.cols, -1);
+        for (size_t i = 0; i < shape.positions.size(); i++) {
+            cell[shape.positions[i].first * shape.cols + shape.positions[i].second] = static_cast<int>(i);
+        }
+        
+        if (!room.adjacency.empty()) {
+            for (auto pair : room.adjacency) {
+                if (pair.first > pair.second) std::swap(pair.first, pair.second);
+                shape.adjacent_pairs.push_back(pair);
+            }
+            std::sort(shape.adjacent_pairs.begin(), shape.adjacent_pairs.end());
+            shape.adjacent_pairs.erase(std::unique(shape.adjacent_pairs.begin(), shape.adjacent_pairs.end()), 
+                                       shape.adjacent_pairs.end());
+        } else {
+            // Each seat looks up the cells of the forward stencil, so every
+            // neighbouring pair is found once whatever the stencil width
+            for (size_t i = 0; i < shape.positions.size(); i++) {
+                int r = shape.positions[i].first;
+                int c = shape.positions[i].second;
+                int self = static_cast<int>(i);
+                for (const auto& offset : stencil) {
+                    int nr = r + offset.first;
+                    int nc = c + offset.second;
+                    if (nr >= shape.rows || nc < 0 || nc >= shape.cols) continue;
+                    int other = cell[nr * shape.cols + nc];
+                    if (other >= 0) shape.adjacent_pairs.push_back({std::min(self, other), std::max(self, other)});
+                }
+            }
+        }
+        
+        // Neighbour CSR from the edge list
+        size_t num_seats = shape.positions.size();
+        shape.neighbour_offset.assign(num_seats + 1, 0);
+        for (const auto& pair : shape.adjacent_pairs) {
+            shape.neighbour_offset[pair.first + 1]++;
+            shape.neighbour_offset[pair.second + 1]++;
+        }
+        for (size_t i = 0; i < num_seats; i++) {
+            shape.neighbour_offset[i + 1] += shape.neighbour_offset[i];
+        }
+        shape.neighbours.resize(shape.neighbour_offset[num_seats]);
+        std::vector<int> fill(shape.neighbour_offset.begin(), shape.neighbour_offset.end() - 1);
+        for (const auto& pair : shape.adjacent_pairs) {
+            shape.neighbours[fill[pair.first]++] = pair.second;
+            shape.neighbours[fill[pair.second]++] = pair.first;
+        }
+        
+        // Explicit adjacency is not a stencil, so those rooms get no shift table
+        shape.board = build_board(shape.rows, shape.cols, shape.positions, 
+                                  room.adjacency.empty() ? stencil : std::vector<std::pair<int, int>>());
+        
+        return shape;
+    }
+    
+    std::vector<RoomShape> build_shape_classes(const std::vector<Room>& rooms, const Separation& separation, 
+                                               std::vector<int>& shape_of) {
+        auto stencil = forward_stencil(separation);
+        std::cout << "Separation: " << describe(separation) << ", " << 2 * stencil.size() 
+                  << " neighbour offsets" << std::endl;
+        
+        using ShapeKey = std::tuple<int, int, bool, int, std::vector<std::pair<int, int>>, std::vector<std::pair<int, int>>>;
+        std::vector<RoomShape> shapes;
+        std::map<ShapeKey, int> shape_index;
+        shape_of.assign(rooms.size(), -1);
+        
+        for (size_t ki = 0; ki < rooms.size(); ki++) {
+            const auto& room = rooms[ki];
+            ShapeKey key = room.seats.empty()
+                ? ShapeKey(room.rows, room.cols, room.skip_rows, room.skip_cols, {}, {})
+                : ShapeKey(0, 0, false, 0, room.seats, room.adjacency);
+            auto it = shape_index.find(key);
+            if (it != shape_index.end()) {
+                shape_of[ki] = it->second;
+                shapes[it->second].rooms.push_back(static_cast<int>(ki));
+                continue;
+            }
+            
+            RoomShape shape = compile_shape(room, stencil);
+            shape.rooms.push_back(static_cast<int>(ki));
+            shape_index.emplace(std::move(key), static_cast<int>(shapes.size()));
+            shape_of[ki] = static_cast<int>(shapes.size());
+            shapes.push_back(std::move(shape));
+        }
+        
+        for (const auto& shape : shapes) {
+            std::cout << "Shape " << shape.rows << "x" << shape.cols
+                      << (shape.custom ? " custom" : "")
+                      << (shape.skip_rows ? " skip_rows" : "");
+            if (shape.skip_cols) std::cout << " skip_cols=" << shape.skip_cols;
+            std::cout << ": " << shape.positions.size() << " positions, "
+                      << shape.adjacent_pairs.size() << " adjacent pairs, "
+                      << shape.rooms.size() << " rooms" << std::endl;
+        }
+        
+        return shapes;
+    }
+    
+    // Rooms are interchangeable only if they share a shape, hold no pinned
+    // student, and every exam restriction either allows all of them or none of them.
+    std::vector<std::vector<int>> symmetric_room_groups(const Problem& problem, const std::vector<RoomShape>& shapes) {
+        std::vector<std::vector<int>> groups;
+        std::vector<char> held(problem.num_rooms, 0);
+        for (const auto& hold : problem.holds) held[hold.room] = 1;
+        
+        for (const auto& shape : shapes) {
+            if (shape.rooms.size() < 2) continue;
+            
+            std::map<std::vector<char>, std::vector<int>> by_signature;
+            for (int ki : shape.rooms) {
+                if (held[ki]) continue;
+                std::vector<char> signature;
+                for (int e = 0; e < problem.num_exams; e++) {
+                    if (problem.restricted[e]) signature.push_back(problem.is_allowed(e, ki));
+                }
+                by_signature[signature].push_back(ki);
+            }
+            
+            for (auto& entry : by_signature) {
+                if (entry.second.size() >= 2) {
+                    groups.push_back(std::move(entry.second));
+                }
+            }
+        }
+        
+        return groups;
+    }
+    
+    // Bin packing plan; when complete, seating receives it seat by seat
+    RoomPlan pack_rooms(
+        const Problem& problem,
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of,
+        const SeatCatalogue& catalogue,
+        Seating& seating,
+        Deadline::Clock::time_point until = Deadline::Clock::time_point::max()
+    ) {
+        BinPacker packer;
+        
+        // Seat budgets are a property of the shape, not of the room
+        std::vector<RoomBudget> budgets;
+        for (const auto& shape : shapes) {
+            budgets.push_back(packer.compute_budget(static_cast<int>(shape.positions.size()), shape.adjacent_pairs,
+                                                    shape.neighbour_offset, shape.neighbours, until));
+        }
+        std::vector<const RoomBudget*> room_budgets(rooms.size());
+        for (size_t ki = 0; ki < rooms.size(); ki++) {
+            room_budgets[ki] = &budgets[shape_of[ki]];
+        }
+        
+        std::vector<ExamDemand> demands(problem.num_exams);
+        for (int e = 0; e < problem.num_exams; e++) {
+            demands[e].count = problem.exam_size(e);
+            demands[e].allowed.assign(rooms.size(), 0);
+            for_each_room(problem.allowed.row(e), problem.allowed.words(), [&](int ki) {
+                demands[e].allowed[ki] = 1;
+            });
+        }
+        
+        // Rooms of pinned students are open in every plan and count towards the bound
+        std::vector<std::vector<int>> taken(rooms.size());
+        for (const auto& hold : problem.holds) taken[hold.room].push_back(hold.position);
+        
+        RoomPlan result;
+        result.lower_bound = packer.lower_bound(demands, room_budgets, taken);
+        
+        PackingPlan ffd = packer.first_fit_decreasing(demands, room_budgets, taken);
+        PackingPlan bfd = packer.best_fit_decreasing(demands, room_budgets, taken);
+        bool use_bfd = (bfd.complete && !ffd.complete) || 
+                       (bfd.complete == ffd.complete && bfd.rooms_used < ffd.rooms_used);
+        const PackingPlan& best = use_bfd ? bfd : ffd;
+        
+        result.method = use_bfd ? "best_fit_decreasing" : "first_fit_decreasing";
+        result.rooms_used = best.rooms_used;
+        result.complete = best.complete;
+        
+        for (const auto& chunk : best.chunks) {
+            result.entries.emplace_back(std::string(problem.exams.name(chunk.exam)), rooms[chunk.room].id, chunk.count);
+        }
+        
+        // Realise the plan: each chunk takes the next free seats of its colour
+        // class, passing over seats that pins closed to the chunk's exam. The
+        // budgets do not know about pins, so a class can run dry; the plan is
+        // then incomplete.
+        seating.clear();
+        if (best.complete) {
+            seating.resize(students.size());
+            std::vector<std::vector<size_t>> next_seat(rooms.size());
+            std::vector<int> next_student(problem.num_exams, 0);
+            
+            for (const auto& chunk : best.chunks) {
+                const auto& shape = shapes[shape_of[chunk.room]];
+                const auto& seats = room_budgets[chunk.room]->colour_classes[chunk.colour];
+                auto& cursor = next_seat[chunk.room];
+                if (cursor.empty()) cursor.assign(room_budgets[chunk.room]->colour_classes.size(), 0);
+                size_t& next = cursor[chunk.colour];
+                
+                for (int n = 0; n < chunk.count && result.complete; n++) {
+                    while (next < seats.size() && 
+                           !catalogue.exam_may_use(chunk.exam, catalogue.seat(chunk.room, seats[next]))) {
+                        next++;
+                    }
+                    if (next == seats.size()) {
+                        result.complete = false;
+                        break;
+                    }
+                    const auto& pos = shape.positions[seats[next++]];
+                    int i = problem.exam_begin(chunk.exam)[next_student[chunk.exam]++];
+                    seating[i] = {chunk.room, pos.first, pos.second};
+                }
+            }
+            if (!result.complete) seating.clear();
+        }
+        
+        std::cout << "Packing (" << result.method << "): " << result.rooms_used << " rooms, "
+                  << (result.complete ? "complete" : "incomplete")
+                  << ", lower bound " << result.lower_bound << std::endl;
+        
+        return result;
+    }
+
+    // Checks one seat per student, no double booking, restrictions and the
+    // separation rule. Used to certify every result before it is reported.
+    bool verify_seating(
+        const Problem& problem,
+        const SeatCatalogue& catalogue,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of,
+        const Seating& seating,
+        std::pmr::memory_resource* arena
+    ) {
+        if (static_cast<int>(seating.size()) != problem.num_students) return false;
+        
+        // Occupied seats of the whole catalogue, and the exam on each of them
+        std::pmr::vector<uint64_t> occupied(catalogue.words, 0, arena);
+        std::pmr::vector<int32_t> exam_at(catalogue.total_seats, -1, arena);
+        std::pmr::vector<char> room_used(problem.num_rooms, 0, arena);
+        
+        for (int i = 0; i < problem.num_students; i++) {
+            const SeatRef& seat = seating[i];
+            if (seat.room < 0 || seat.room >= problem.num_rooms) return false;
+            
+            const auto& shape = shapes[shape_of[seat.room]];
+            if (seat.row < 0 || seat.row >= shape.rows || seat.col < 0 || seat.col >= shape.cols) return false;
+            int position = shape.cell[seat.row * shape.cols + seat.col];
+            if (position < 0) return false;
+            
+            int s = catalogue.seat(seat.room, position);
+            int e = problem.exam_of[i];
+            if (!catalogue.exam_may_use(e, s) || test_bit(occupied.data(), s)) return false;
+            set_bit(occupied.data(), s);
+            exam_at[s] = e;
+            room_used[seat.room] = 1;
+        }
+        
+        const BitboardKernels& kernels = bitboard_kernels();
+        std::pmr::vector<std::pair<int32_t, int32_t>> entries(arena);  // (exam, cell) of one room
+        std::pmr::vector<uint64_t> occupancy(arena);
+        std::pmr::vector<uint64_t> blocked(arena);
+        
+        for (int ki = 0; ki < problem.num_rooms; ki++) {
+            if (!room_used[ki]) continue;
+            const auto& shape = shapes[shape_of[ki]];
+            const int32_t* room_exams = exam_at.data() + catalogue.room_offset[ki];
+            
+            if (shape.board.shifts.empty()) {
+                for (const auto& pair : shape.adjacent_pairs) {
+                    int32_t e1 = room_exams[pair.first];
+                    if (e1 >= 0 && e1 == room_exams[pair.second]) return false;
+                }
+                continue;
+            }
+            
+            // Stencil rooms: the cells next to each exam's students must not
+            // hold another student of that exam
+            entries.clear();
+            for (size_t p = 0; p < shape.positions.size(); p++) {
+                if (room_exams[p] >= 0) entries.push_back({room_exams[p], shape.board.cell_of[p]});
+            }
+            std::sort(entries.begin(), entries.end());
+            blocked.resize(shape.board.words);
+            for (size_t a = 0; a < entries.size();) {
+                size_t b = a;
+                occupancy.assign(shape.board.words, 0);
+                for (; b < entries.size() && entries[b].first == entries[a].first; b++) {
+                    set_bit(occupancy.data(), entries[b].second);
+                }
+                if (b - a > 1) {
+                    blocked_cells(shape.board, occupancy.data(), blocked.data());
+                    if (kernels.intersects(occupancy.data(), blocked.data(), shape.board.words)) return false;
+                }
+                a = b;
+            }
+        }
+        
+        return true;
+    }
+    
+    // Seat-by-seat first fit on the room bitboards. Exams go largest first;
+    // each student takes the first legal seat of the earliest opened room that
+    // has one, and a new room (largest first) is opened only when none does.
+    // A non-zero seed jitters the exam and room orders and starts each room's
+    // seat scan at a random word. Returns the number of students seated.
+    int greedy_seating(
+        const Problem& problem,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of,
+        uint64_t seed,
+        std::pmr::memory_resource* arena,
+        Seating& seating
+    ) const {
+        const BitboardKernels& kernels = bitboard_kernels();
+        const int num_rooms = problem.num_rooms;
+        
+        // Free cells of every room, one board after another
+        std::pmr::vector<int32_t> board_offset(num_rooms + 1, 0, arena);
+        for (int ki = 0; ki < num_rooms; ki++) {
+            board_offset[ki + 1] = board_offset[ki] + shapes[shape_of[ki]].board.words;
+        }
+        std::pmr::vector<uint64_t> free_cells(board_offset.back(), 0, arena);
+        for (int ki = 0; ki < num_rooms; ki++) {
+            const auto& seats = shapes[shape_of[ki]].board.seats;
+            std::copy(seats.begin(), seats.end(), free_cells.begin() + board_offset[ki]);
+        }
+        
+        // Cells next to an exam's students, one board per (room, exam) in use
+        std::pmr::unordered_map<int64_t, int32_t> blocked_at(arena);
+        std::pmr::vector<uint64_t> blocked(arena);
+        auto blocked_board = [&](int ki, int e) {
+            int64_t key = static_cast<int64_t>(ki) * problem.num_exams + e;
+            auto it = blocked_at.find(key);
+            if (it == blocked_at.end()) {
+                it = blocked_at.emplace(key, static_cast<int32_t>(blocked.size())).first;
+                blocked.resize(blocked.size() + shapes[shape_of[ki]].board.words, 0);
+            }
+            return blocked.data() + it->second;
+        };
+        
+        // Sort keys: sizes, scaled by up to 25% either way for a seeded start
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> jitter(0.75, 1.25);
+        auto noise = [&]() { return seed == 0 ? 1.0 : jitter(rng); };
+        
+        std::pmr::vector<double> room_key(num_rooms, 0, arena);
+        std::pmr::vector<int32_t> origin(num_rooms, 0, arena);  // first word of each room's seat scan
+        for (int ki = 0; ki < num_rooms; ki++) {
+            const auto& shape = shapes[shape_of[ki]];
+            room_key[ki] = shape.positions.size() * noise();
+            if (seed != 0 && shape.board.words > 0) origin[ki] = static_cast<int32_t>(rng() % shape.board.words);
+        }
+        std::pmr::vector<double> exam_key(problem.num_exams, 0, arena);
+        for (int e = 0; e < problem.num_exams; e++) {
+            exam_key[e] = problem.exam_size(e) * noise();
+        }
+        
+        std::pmr::vector<int32_t> room_order(num_rooms, 0, arena);
+        std::iota(room_order.begin(), room_order.end(), 0);
+        std::stable_sort(room_order.begin(), room_order.end(), [&](int a, int b) {
+            return room_key[a] > room_key[b];
+        });
+        std::pmr::vector<int32_t> exam_order(problem.num_exams, 0, arena);
+        std::iota(exam_order.begin(), exam_order.end(), 0);
+        std::stable_sort(exam_order.begin(), exam_order.end(), [&](int a, int b) {
+            return exam_key[a] > exam_key[b];
+        });
+        
+        std::pmr::vector<int32_t> open(arena);
+        std::pmr::vector<char> is_open(num_rooms, 0, arena);
+        seating.assign(problem.num_students, SeatRef());
+        int seated = 0;
+        
+        // Seats of pinned students are taken and block their exam's neighbours.
+        // Their rooms are in use anyway, so they are opened first.
+        for (const auto& hold : problem.holds) {
+            const auto& shape = shapes[shape_of[hold.room]];
+            clear_bit(free_cells.data() + board_offset[hold.room], shape.board.cell_of[hold.position]);
+            if (hold.exam >= 0) {
+                uint64_t* room_blocked = blocked_board(hold.room, hold.exam);
+                for (int n = shape.neighbour_offset[hold.position]; n < shape.neighbour_offset[hold.position + 1]; n++) {
+                    set_bit(room_blocked, shape.board.cell_of[shape.neighbours[n]]);
+                }
+            }
+            if (!is_open[hold.room]) {
+                is_open[hold.room] = 1;
+                open.push_back(hold.room);
+            }
+        }
+        
+        for (int e : exam_order) {
+            auto try_room = [&](int ki, int i) {
+                const auto& shape = shapes[shape_of[ki]];
+                uint64_t* room_free = free_cells.data() + board_offset[ki];
+                uint64_t* room_blocked = blocked_board(ki, e);
+                int words = shape.board.words;
+                int from = origin[ki];
+                int cell = kernels.first_free(room_free + from, room_blocked + from, words - from);
+                if (cell >= 0) cell += from * 64;
+                else cell = kernels.first_free(room_free, room_blocked, from);
+                if (cell < 0) return false;
+                
+                int row = cell / shape.board.stride;
+                int col = cell % shape.board.stride;
+                int p = shape.cell[row * shape.cols + col];
+                room_free[cell >> 6] &= ~(uint64_t(1) << (cell & 63));
+                for (int n = shape.neighbour_offset[p]; n < shape.neighbour_offset[p + 1]; n++) {
+                    set_bit(room_blocked, shape.board.cell_of[shape.neighbours[n]]);
+                }
+                seating[i] = {ki, row, col};
+                return true;
+            };
+            
+            // Seats only ever get taken or blocked, so a room that has no legal
+            // seat for this exam never gets one again
+            size_t first_open = 0;
+            size_t next_new = 0;
+            for (const int32_t* it = problem.exam_begin(e); it != problem.exam_end(e); it++) {
+                bool placed = false;
+                while (!placed && first_open < open.size()) {
+                    int ki = open[first_open];
+                    if (problem.is_allowed(e, ki) && try_room(ki, *it)) placed = true;
+                    else first_open++;
+                }
+                while (!placed && next_new < room_order.size()) {
+                    int ki = room_order[next_new++];
+                    if (is_open[ki] || !problem.is_allowed(e, ki)) continue;
+                    is_open[ki] = 1;
+                    open.push_back(ki);
+                    placed = try_room(ki, *it);
+                }
+                if (placed) seated++;
+            }
+        }
+        
+        return seated;
+    }
+    
+    struct GreedyRun {
+        int start = -1;
+        uint64_t seed = 0;
+        int rooms_used = INT_MAX;
+        double imbalance = 0;          // spread of fill ratios over the rooms used
+        std::vector<SeatRef> seating;
+        
+        // Fewer rooms, then more even fill, then the earlier start
+        bool better_than(const GreedyRun& other) const {
+            if (rooms_used != other.rooms_used) return rooms_used < other.rooms_used;
+            if (imbalance != other.imbalance) return imbalance < other.imbalance;
+            return other.start < 0 || start < other.start;
+        }
+    };
+    
+    double fill_imbalance(const Seating& seating, const std::vector<RoomShape>& shapes, 
+                          const std::vector<int>& shape_of, int num_rooms) const {
+        std::vector<int> load(num_rooms, 0);
+        for (const auto& seat : seating) {
+            if (seat.room >= 0) load[seat.room]++;
+        }
+        double sum = 0, sum_sq = 0;
+        int used = 0;
+        for (int ki = 0; ki < num_rooms; ki++) {
+            if (load[ki] == 0) continue;
+            double fill = static_cast<double>(load[ki]) / shapes[shape_of[ki]].positions.size();
+            sum += fill;
+            sum_sq += fill * fill;
+            used++;
+        }
+        if (used == 0) return 0;
+        double mean = sum / used;
+        return std::sqrt(std::max(0.0, sum_sq / used - mean * mean));
+    }
+    
+    // options.greedy_starts greedy runs spread over the task pool, each worker
+    // with its own arena. The winner does not depend on thread timing: runs are
+    // compared by rooms, balance and start index. Starts other than the first
+    // not yet begun when until passes or stop() is called are skipped.
+    GreedyRun multistart_greedy(
+        const Problem& problem,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of,
+        const SolveOptions& options,
+        Deadline::Clock::time_point until
+    ) {
+        int starts = std::max(1, options.greedy_starts);
+        int threads = task_pool().width(options.num_threads, static_cast<size_t>(starts));
+        
+        std::atomic<int> next_start{0};
+        std::atomic<int> completed{0};
+        std::mutex best_mutex;
+        GreedyRun best;
+        
+        auto worker = [&]() {
+            std::pmr::monotonic_buffer_resource arena(arena_bytes(problem.num_students, problem.num_rooms));
+            GreedyRun local;
+            for (int j = next_start++; j < starts; j = next_start++) {
+                if (j > 0 && (stop_requested_ || Deadline::Clock::now() > until)) break;
+                
+                uint64_t seed = options.seed + static_cast<uint64_t>(j);
+                {
+                    Seating seating(&arena);
+                    if (greedy_seating(problem, shapes, shape_of, seed, &arena, seating) == problem.num_students) {
+                        GreedyRun run;
+                        run.start = j;
+                        run.seed = seed;
+                        run.rooms_used = count_rooms(problem, seating);
+                        run.imbalance = fill_imbalance(seating, shapes, shape_of, problem.num_rooms);
+                        if (run.better_than(local)) {
+                            run.seating.assign(seating.begin(), seating.end());
+                            local = std::move(run);
+                        }
+                    }
+                }
+                completed++;
+                arena.release();
+            }
+            
+            std::lock_guard<std::mutex> lock(best_mutex);
+            if (local.start >= 0 && local.better_than(best)) best = std::move(local);
+        };
+        
+        task_pool().run(threads, worker);
+        
+        std::cout << "Greedy (" << bitboard_kernels().name << " kernels): " << completed << " of " << starts 
+                  << " starts on " << threads << " threads";
+        if (best.start >= 0) {
+            std::cout << ", best seed " << best.seed << ": " << best.rooms_used << " rooms";
+        } else {
+            std::cout << ", no complete seating";
+        }
+        std::cout << std::endl;
+        return best;
+    }
+    
+    // Rough CP-SAT cost per model variable and per linear term, covering the
+    // presolved copy and the search workers. Only used to pick a formulation
+    // before anything is built.
+    static constexpr double BYTES_PER_VARIABLE = 800.0;
+    static constexpr double BYTES_PER_TERM = 80.0;
+    
+    // Candidate seats that survive restriction and capacity pruning, in compact
+    // int32 arrays. Each model row (a student, or a whole exam in the exam
+    // formulation) of exam e owns exam_width[e] consecutive variables: the
+    // seats of its candidate rooms, room after room. Variables themselves are
+    // never stored, only their proto indices are computed.
+    struct CandidateLayout {
+        int num_rooms = 0;
+        std::pmr::vector<int32_t> exam_width;       // variables per row of each exam
+        std::pmr::vector<int32_t> room_start;       // [e * num_rooms + k] -> offset in row, -1 if pruned
+        std::pmr::vector<int32_t> rooms_offset;     // candidate rooms of exam e: candidate_rooms[rooms_offset[e] ..]
+        std::pmr::vector<int32_t> candidate_rooms;
+        
+        // Rows of the chosen formulation
+        std::pmr::vector<int64_t> row_offset;       // first variable of each row, plus end marker
+        std::pmr::vector<int32_t> row_exam;
+        std::pmr::vector<int32_t> members_offset;   // rows of exam e: members[members_offset[e] ..]
+        std::pmr::vector<int32_t> members;
+        
+        explicit CandidateLayout(std::pmr::memory_resource* arena)
+            : exam_width(arena), room_start(arena), rooms_offset(arena), candidate_rooms(arena),
+              row_offset(arena), row_exam(arena), members_offset(arena), members(arena) {}
+        
+        int32_t start(int e, int ki) const { return room_start[static_cast<size_t>(e) * num_rooms + ki]; }
+        int64_t num_variables() const { return row_offset.empty() ? 0 : row_offset.back(); }
+        const int32_t* rooms_begin(int e) const { return candidate_rooms.data() + rooms_offset[e]; }
+        const int32_t* rooms_end(int e) const { return candidate_rooms.data() + rooms_offset[e + 1]; }
+        const int32_t* rows_begin(int e) const { return members.data() + members_offset[e]; }
+        const int32_t* rows_end(int e) const { return members.data() + members_offset[e + 1]; }
+    };
+    
+    CandidateLayout build_candidates(
+        const Problem& problem,
+        const SeatCatalogue& catalogue,
+        const std::vector<char>& pruned,
+        std::pmr::memory_resource* arena
+    ) {
+        CandidateLayout layout(arena);
+        layout.num_rooms = problem.num_rooms;
+        layout.exam_width.assign(problem.num_exams, 0);
+        layout.room_start.assign(static_cast<size_t>(problem.num_exams) * problem.num_rooms, -1);
+        layout.rooms_offset.assign(1, 0);
+        
+        // Rooms that survive capacity pruning
+        std::pmr::vector<uint64_t> open_rooms(problem.allowed.words(), 0, arena);
+        for (int ki = 0; ki < problem.num_rooms; ki++) {
+            if (!pruned[ki]) set_bit(open_rooms.data(), ki);
+        }
+        
+        // Candidates of an exam are whole rooms: its restriction masks AND the
+        // open masks. Seats closed by pins inside a candidate room keep their
+        // variables and are fixed to zero by the model.
+        std::pmr::vector<uint64_t> rooms(problem.allowed.words(), 0, arena);
+        for (int e = 0; e < problem.num_exams; e++) {
+            const uint64_t* allowed = problem.allowed.row(e);
+            for (int w = 0; w < problem.allowed.words(); w++) {
+                rooms[w] = allowed[w] & open_rooms[w];
+            }
+            int32_t start = 0;
+            for_each_room(rooms.data(), problem.allowed.words(), [&](int ki) {
+                layout.room_start[static_cast<size_t>(e) * problem.num_rooms + ki] = start;
+                layout.candidate_rooms.push_back(ki);
+                start += catalogue.room_offset[ki + 1] - catalogue.room_offset[ki];
+            });
+            layout.exam_width[e] = start;
+            layout.rooms_offset.push_back(static_cast<int32_t>(layout.candidate_rooms.size()));
+        }
+        
+        return layout;
+    }
+    
+    // One row per student ("student" formulation) or per exam ("exam" formulation)
+    void layout_rows(CandidateLayout& layout, const Problem& problem, bool per_student) {
+        layout.row_offset.assign(1, 0);
+        layout.row_exam.clear();
+        
+        if (per_student) {
+            layout.members.assign(problem.exam_members.begin(), problem.exam_members.end());
+            layout.members_offset.assign(problem.exam_offset.begin(), problem.exam_offset.end());
+        } else {
+            layout.members.resize(problem.num_exams);
+            layout.members_offset.resize(problem.num_exams + 1);
+            std::iota(layout.members.begin(), layout.members.end(), 0);
+            std::iota(layout.members_offset.begin(), layout.members_offset.end(), 0);
+        }
+        
+        size_t num_rows = per_student ? problem.num_students : problem.num_exams;
+        for (size_t row = 0; row < num_rows; row++) {
+            int32_t e = per_student ? problem.exam_of[row] : static_cast<int32_t>(row);
+            layout.row_exam.push_back(e);
+            layout.row_offset.push_back(layout.row_offset.back() + layout.exam_width[e]);
+        }
+    }
+    
+    // Estimated CP-SAT footprint of a formulation in megabytes, before it is built
+    double estimate_model_mb(const Problem& problem, const CandidateLayout& layout, 
+                             const std::vector<RoomShape>& shapes, const std::vector<int>& shape_of, 
+                             bool per_student, bool secondary) {
+        double variables = 0, terms = 0;
+        for (int e = 0; e < problem.num_exams; e++) {
+            double rows = per_student ? problem.exam_size(e) : 1;
+            double cells = rows * layout.exam_width[e];
+            variables += cells;
+            terms += 3 * cells;  // row sum, seat capacity, room load
+            
+            if (problem.exam_size(e) < 2 && !secondary) continue;
+            for (const int32_t* ki = layout.rooms_begin(e); ki != layout.rooms_end(e); ki++) {
+                const auto& shape = shapes[shape_of[*ki]];
+                if (secondary) {
+                    // Spread indicator and load variable of the (exam, room) pair
+                    variables += 2;
+                    terms += 2.0 * shape.positions.size() + 4;
+                }
+                if (rows > 1) {
+                    // Per-seat occupancy literal linked to every row of the exam
+                    variables += shape.positions.size();
+                    terms += (rows + 1) * shape.positions.size();
+                }
+                terms += 2.0 * shape.adjacent_pairs.size();
+            }
+        }
+        return (variables * BYTES_PER_VARIABLE + terms * BYTES_PER_TERM) / (1024.0 * 1024.0);
+    }
+    
+    // CP-SAT model over the candidate layout. Improves best (a complete seating
+    // or empty) and stores the solver status and objective bound in result.
+    // Returns false without solving if the memory ceiling or the build budget
+    // is reached while the model is built; the caller then keeps best.
+    bool solve_cpsat(
+        const Problem& problem,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of,
+        const std::vector<std::vector<int>>& symmetric_groups,
+        const CandidateLayout& layout,
+        bool per_student,
+        const RoomPlan& plan,
+        const Seating& hint_seating,
+        const SolveOptions& options,
+        std::chrono::high_resolution_clock::time_point start_time,
+        Deadline& deadline,
+        std::pmr::memory_resource* arena,
+        Seating& best,
+        SolveResult& result
+    ) {
+        CpModelBuilder cp_model;
+        const size_t num_rows = layout.row_exam.size();
+        const int num_rooms = problem.num_rooms;
+        
+        // Checked between rooms and exams and every 2^20 variables while building
+        auto over_budget = [&]() {
+            if (stop_requested_ || deadline.phase_expired()) {
+                std::cout << (stop_requested_ ? "Stopped" : "Build budget used up") 
+                          << " while building the model (" << deadline.summary() << ")" << std::endl;
+                return true;
+            }
+            if (options.memory_limit_mb <= 0 || current_rss_mb() <= options.memory_limit_mb) return false;
+            std::cout << "Memory ceiling of " << options.memory_limit_mb 
+                      << " MB reached while building the model" << std::endl;
+            return true;
+        };
+        
+        // Room usage variables
+        std::vector<BoolVar> y;
+        for (int ki = 0; ki < num_rooms; ki++) {
+            y.push_back(cp_model.NewBoolVar());
+        }
+        
+        // Candidate variables are created back to back, so the variable of
+        // (row, room, seat) is x_base + row_offset[row] + start(exam, room) + seat
+        const int x_base = num_rooms;
+        for (int64_t v = 0; v < layout.num_variables(); v++) {
+            cp_model.NewBoolVar();
+            if (v % (1 << 20) == 0 && over_budget()) return false;
+        }
+        auto var = [&](size_t row, int64_t offset) {
+            return cp_model.GetBoolVarFromProtoIndex(x_base + static_cast<int>(layout.row_offset[row] + offset));
+        };
+        auto x = [&](size_t row, int ki, size_t seat) {
+            return var(row, layout.start(layout.row_exam[row], ki) + static_cast<int64_t>(seat));
+        };
+        
+        std::cout << "Created " << layout.num_variables() << " variables (" 
+                  << (per_student ? "student" : "exam") << " formulation)" << std::endl;
+        
+        // Constraint 1: each student sits exactly once, or each exam fills its headcount
+        std::pmr::vector<BoolVar> terms(arena);
+        for (size_t row = 0; row < num_rows; row++) {
+            int e = layout.row_exam[row];
+            terms.clear();
+            for (int32_t v = 0; v < layout.exam_width[e]; v++) {
+                terms.push_back(var(row, v));
+            }
+            int demand = per_student ? 1 : problem.exam_size(e);
+            cp_model.AddEquality(LinearExpr::Sum(terms), demand);
+        }
+        
+        // Constraint 2: at most one student per seat, and only in rooms that are used
+        auto room_terms = [&](int ki, size_t seat, std::pmr::vector<BoolVar>& out) {
+            for (int e = 0; e < problem.num_exams; e++) {
+                if (layout.start(e, ki) < 0) continue;
+                for (const int32_t* row = layout.rows_begin(e); row != layout.rows_end(e); row++) {
+                    out.push_back(x(*row, ki, seat));
+                }
+            }
+        };
+        
+        std::vector<std::vector<char>> held(num_rooms);  // seats of pinned students
+        for (const auto& hold : problem.holds) {
+            auto& seats = held[hold.room];
+            if (seats.empty()) seats.assign(shapes[shape_of[hold.room]].positions.size(), 0);
+            seats[hold.position] = 1;
+        }
+        
+        for (int ki = 0; ki < num_rooms; ki++) {
+            const auto& shape = shapes[shape_of[ki]];
+            bool has_candidates = false;
+            for (size_t seat = 0; seat < shape.positions.size(); seat++) {
+                terms.clear();
+                room_terms(ki, seat, terms);
+                if (terms.empty()) break;
+                if (!held[ki].empty() && held[ki][seat]) {
+                    cp_model.AddEquality(LinearExpr::Sum(terms), 0);
+                    continue;
+                }
+                cp_model.AddLessOrEqual(LinearExpr::Sum(terms), y[ki]);
+                has_candidates = true;
+            }
+            if (!held[ki].empty()) {
+                // A room holding pinned students is used whatever else it seats
+                cp_model.AddEquality(y[ki], 1);
+            } else if (!has_candidates) {
+                // Pruned, or allowed for no exam
+                cp_model.AddEquality(y[ki], 0);
+            }
+            
+            if (over_budget()) return false;
+        }
+        
+        // Neighbours of a pinned student are closed to the student's exam
+        for (const auto& hold : problem.holds) {
+            if (hold.exam < 0 || layout.start(hold.exam, hold.room) < 0) continue;
+            const auto& shape = shapes[shape_of[hold.room]];
+            for (int n = shape.neighbour_offset[hold.position]; n < shape.neighbour_offset[hold.position + 1]; n++) {
+                terms.clear();
+                for (const int32_t* row = layout.rows_begin(hold.exam); row != layout.rows_end(hold.exam); row++) {
+                    terms.push_back(x(*row, hold.room, shape.neighbours[n]));
+                }
+                cp_model.AddEquality(LinearExpr::Sum(terms), 0);
+            }
+        }
+        
+        // Symmetry breaking: within a group of interchangeable rooms, earlier rooms
+        // are opened first and hold at least as many students as later ones
+        int symmetry_count = 0;
+        for (const auto& group : symmetric_groups) {
+            std::vector<IntVar> load;
+            for (int ki : group) {
+                const auto& shape = shapes[shape_of[ki]];
+                terms.clear();
+                for (size_t seat = 0; seat < shape.positions.size(); seat++) {
+                    room_terms(ki, seat, terms);
+                }
+                load.push_back(cp_model.NewIntVar(operations_research::Domain(0, static_cast<int64_t>(shape.positions.size()))));
+                cp_model.AddEquality(LinearExpr::Sum(terms), load.back());
+            }
+            for (size_t g = 0; g + 1 < group.size(); g++) {
+                cp_model.AddGreaterOrEqual(y[group[g]], y[group[g + 1]]);
+                cp_model.AddGreaterOrEqual(load[g], load[g + 1]);
+                symmetry_count++;
+            }
+        }
+        
+        std::cout << "Added " << symmetry_count << " symmetry-breaking constraints" << std::endl;
+        
+        // Constraint 3: separation. Each exam gets one occupancy literal per seat
+        // (the row variable itself in the exam formulation), and two adjacent
+        // seats are never both occupied by the same exam. Exact and linear in
+        // seats, instead of one constraint per pair of students.
+        //
+        // In lazy mode the pair constraints are left out here and added as cuts
+        // once a solution violates them, so the model carries only the pairs
+        // that actually matter for this instance.
+        //
+        // The secondary objective reuses the same literals: one indicator per
+        // (exam, room) bounds the exam's occupancy of the room, and one load
+        // variable per (exam, room) feeds the room fill. Both are per candidate
+        // room, so the model grows by two variables per (exam, room), not per student.
+        const bool spread = options.spread_weight > 0;
+        const bool balance = options.balance_weight > 0;
+        const bool lazy = options.separation_mode == "lazy";
+        int64_t separation_count = 0;
+        
+        // Occupancy literal of (exam, room, seat). In lazy mode literals are kept
+        // by the seat's variable in the exam's first row, so cuts reuse them.
+        std::unordered_map<int64_t, BoolVar> occupancy_of;
+        auto occupied = [&](int e, int ki, size_t seat) {
+            const int32_t* rows_begin = layout.rows_begin(e);
+            const int32_t* rows_end = layout.rows_end(e);
+            if (rows_end - rows_begin == 1) return x(*rows_begin, ki, seat);
+            
+            int64_t id = layout.row_offset[*rows_begin] + layout.start(e, ki) + static_cast<int64_t>(seat);
+            if (lazy) {
+                auto it = occupancy_of.find(id);
+                if (it != occupancy_of.end()) return it->second;
+            }
+            terms.clear();
+            for (const int32_t* row = rows_begin; row != rows_end; row++) {
+                terms.push_back(x(*row, ki, seat));
+            }
+            BoolVar literal = cp_model.NewBoolVar();
+            cp_model.AddEquality(LinearExpr::Sum(terms), literal);
+            if (lazy) occupancy_of.emplace(id, literal);
+            return literal;
+        };
+        
+        std::pmr::vector<BoolVar> occupancy(arena);
+        std::vector<BoolVar> exam_in_room;
+        std::vector<std::vector<IntVar>> room_load(balance ? num_rooms : 0);
+        for (int e = 0; e < problem.num_exams; e++) {
+            const bool separate = problem.exam_size(e) >= 2;
+            const bool count_spread = spread && separate;  // a single student is always in one room
+            if (!separate && !balance) continue;
+            
+            for (const int32_t* room = layout.rooms_begin(e); room != layout.rooms_end(e); room++) {
+                int ki = *room;
+                const auto& shape = shapes[shape_of[ki]];
+                bool has_pairs = separate && !shape.adjacent_pairs.empty() && !lazy;
+                if (!has_pairs && !count_spread && !balance) continue;
+                
+                occupancy.clear();
+                for (size_t seat = 0; seat < shape.positions.size(); seat++) {
+                    occupancy.push_back(occupied(e, ki, seat));
+                }
+                
+                if (has_pairs) {
+                    for (const auto& pair : shape.adjacent_pairs) {
+                        cp_model.AddLessOrEqual(LinearExpr::Sum({occupancy[pair.first], occupancy[pair.second]}), 1);
+                        separation_count++;
+                    }
+                }
+                
+                int most = std::min(problem.exam_size(e), static_cast<int>(shape.positions.size()));
+                if (count_spread) {
+                    BoolVar used = cp_model.NewBoolVar();
+                    cp_model.AddLessOrEqual(LinearExpr::Sum(occupancy), LinearExpr(used) * most);
+                    cp_model.AddLessOrEqual(used, y[ki]);
+                    exam_in_room.push_back(used);
+                }
+                if (balance) {
+                    IntVar load = cp_model.NewIntVar(operations_research::Domain(0, most));
+                    cp_model.AddEquality(LinearExpr::Sum(occupancy), load);
+                    room_load[ki].push_back(load);
+                }
+            }
+            
+            if (over_budget()) return false;
+        }
+        
+        if (lazy) {
+            std::cout << "Separation constraints deferred (lazy mode)" << std::endl;
+        } else {
+            std::cout << "Added " << separation_count << " separation constraints" << std::endl;
+        }
+        
+        // Objective: minimize rooms used, then the weighted spread and fill
+        // peak. Rooms are scaled past the largest possible secondary term, so
+        // the secondary objective only ranks seatings with equal room counts.
+        int64_t secondary_max = 0;
+        std::vector<LinearExpr> secondary;
+        if (spread) {
+            secondary.push_back(LinearExpr::Sum(exam_in_room) * options.spread_weight);
+            secondary_max += static_cast<int64_t>(options.spread_weight) * static_cast<int64_t>(exam_in_room.size());
+        }
+        if (balance) {
+            IntVar peak = cp_model.NewIntVar(operations_research::Domain(0, 100));
+            for (int ki = 0; ki < num_rooms; ki++) {
+                if (room_load[ki].empty()) continue;
+                int64_t seats = static_cast<int64_t>(shapes[shape_of[ki]].positions.size());
+                cp_model.AddLessOrEqual(LinearExpr::Sum(room_load[ki]) * 100, LinearExpr(peak) * seats);
+            }
+            secondary.push_back(LinearExpr(peak) * options.balance_weight);
+            secondary_max += 100 * static_cast<int64_t>(options.balance_weight);
+        }
+        const int64_t room_weight = secondary_max + 1;
+        
+        LinearExpr objective = LinearExpr::Sum(y) * room_weight;
+        for (const auto& term : secondary) objective += term;
+        cp_model.Minimize(objective);
+        cp_model.AddGreaterOrEqual(LinearExpr::Sum(y), plan.lower_bound);
+        
+        if (spread || balance) {
+            std::cout << "Secondary objective: spread weight " << options.spread_weight 
+                      << ", balance weight " << options.balance_weight 
+                      << " (" << exam_in_room.size() << " exam-room indicators)" << std::endl;
+        }
+        
+        // Room count certified by an objective bound: any seating costs
+        // room_weight * rooms plus at most secondary_max
+        auto rooms_bound = [&](double objective_bound) {
+            return static_cast<int>(std::ceil((objective_bound - secondary_max) / room_weight - 1e-6));
+        };
+        
+        // Warm start from a seating. A partial hint (a cached seating of a
+        // near-identical request) only marks the rooms it uses.
+        auto add_hints = [&](const Seating& hint_seating) {
+            std::vector<bool> room_used(num_rooms, false);
+            for (const auto& hold : problem.holds) room_used[hold.room] = true;
+            bool complete = true;
+            for (int i = 0; i < problem.num_students; i++) {
+                const SeatRef& s = hint_seating[i];
+                if (s.room < 0) {
+                    complete = false;
+                    continue;
+                }
+                int e = problem.exam_of[i];
+                room_used[s.room] = true;
+                if (layout.start(e, s.room) < 0) continue;
+                
+                const auto& shape = shapes[shape_of[s.room]];
+                int seat = shape.cell[s.row * shape.cols + s.col];
+                cp_model.AddHint(x(per_student ? i : e, s.room, seat), true);
+            }
+            for (int ki = 0; ki < num_rooms; ki++) {
+                if (complete || room_used[ki]) cp_model.AddHint(y[ki], room_used[ki]);
+            }
+        };
+        if (!hint_seating.empty()) add_hints(hint_seating);
+        
+        // Map a variable offset within a row of exam e back to (room, seat)
+        auto locate = [&](int e, int64_t offset) {
+            for (const int32_t* room = layout.rooms_begin(e); room != layout.rooms_end(e); room++) {
+                int64_t seats = static_cast<int64_t>(shapes[shape_of[*room]].positions.size());
+                if (offset < seats) return std::make_pair(static_cast<int>(*room), static_cast<int>(offset));
+                offset -= seats;
+            }
+            return std::make_pair(-1, -1);
+        };
+        
+        // Fill seating from a solution, returns the number of students seated
+        auto extract = [&](const CpSolverResponse& response, Seating& seating) {
+            seating.assign(problem.num_students, SeatRef());
+            int seated = 0;
+            
+            for (size_t row = 0; row < num_rows; row++) {
+                int e = layout.row_exam[row];
+                int next_student = 0;
+                
+                for (int32_t v = 0; v < layout.exam_width[e]; v++) {
+                    if (!SolutionBooleanValue(response, var(row, v))) continue;
+                    auto seat = locate(e, v);
+                    const auto& pos = shapes[shape_of[seat.first]].positions[seat.second];
+                    
+                    // Exam rows hand their seats out to the exam's students in order
+                    int i = per_student ? static_cast<int>(row) : problem.exam_begin(e)[next_student++];
+                    seating[i] = {seat.first, pos.first, pos.second};
+                    seated++;
+                    
+                    if (per_student || next_student == problem.exam_size(e)) break;
+                }
+            }
+            
+            return seated;
+        };
+        
+        // Solve. One CP-SAT run per round; eager mode needs exactly one.
+        int best_rooms = best.empty() ? INT_MAX : result.rooms_used;
+        Seating candidate(arena);
+        auto solve_round = [&](double seconds) {
+            TaskPool::SolverThreads search_threads(task_pool(), 4);
+            SatParameters parameters;
+            parameters.set_max_time_in_seconds(seconds);
+            parameters.set_num_search_workers(search_threads.threads());
+            parameters.set_search_branching(SatParameters::PORTFOLIO_SEARCH);
+            parameters.set_cp_model_presolve(true);
+            if (options.memory_limit_mb > 0) {
+                parameters.set_max_memory_in_mb(options.memory_limit_mb);
+            }
+            
+            Model model;
+            model.Add(NewSatParameters(parameters));
+            model.GetOrCreate<TimeLimit>()->RegisterExternalBooleanAsLimit(&stop_requested_);
+            
+            // Anytime reporting: stream each improving solution and stop once it is
+            // good enough. The observer reuses one seating buffer for every
+            // solution; in lazy mode solutions that break separation are skipped.
+            model.Add(NewFeasibleSolutionObserver([&](const CpSolverResponse& response) {
+                int seated = extract(response, candidate);
+                int rooms_used = count_rooms(problem, candidate);
+                if (seated != problem.num_students || rooms_used >= best_rooms) return;
+                if (lazy && find_violations(problem, shapes, shape_of, candidate, nullptr) > 0) return;
+                best_rooms = rooms_used;
+                
+                int bound = std::max(result.lower_bound, rooms_bound(response.best_objective_bound()));
+                publish_progress(options, start_time, "cpsat", rooms_used, bound, candidate);
+                
+                if (!spread && !balance && rooms_used - bound <= options.accept_gap) {
+                    stop_requested_ = true;
+                }
+            }));
+            
+            return SolveCpModel(cp_model.Build(), &model);
+        };
+        
+        std::vector<Violation> violations;
+        
+        // Lazy rounds share the search phase: while more than two seconds are
+        // left a round gets half of them, so the relaxed first round cannot
+        // starve the re-solves after it
+        deadline.begin(Phase::Search);
+        auto round_seconds = [&]() {
+            double left = deadline.phase_seconds();
+            return lazy && left > 2.0 ? left / 2 : left;
+        };
+        std::cout << "Starting C++ solver with " << deadline.phase_seconds() << " s to search..." << std::endl;
+        CpSolverResponse response = solve_round(round_seconds());
+        
+        // Lazy separation: every round adds the pairs the last solution put
+        // side by side and re-solves from that solution. The relaxation only
+        // loses constraints, so its bound stays valid for the full model.
+        for (int round = 1; lazy && !stop_requested_; round++) {
+            if (response.status() != CpSolverStatus::OPTIMAL && response.status() != CpSolverStatus::FEASIBLE) break;
+            extract(response, candidate);
+            violations.clear();
+            if (find_violations(problem, shapes, shape_of, candidate, &violations) == 0) break;
+            
+            if (deadline.phase_expired()) break;
+            
+            for (const auto& v : violations) {
+                cp_model.AddLessOrEqual(LinearExpr::Sum({occupied(v.exam, v.room, v.first), 
+                                                         occupied(v.exam, v.room, v.second)}), 1);
+            }
+            separation_count += static_cast<int64_t>(violations.size());
+            std::cout << "Lazy separation round " << round << ": added " << violations.size() 
+                      << " constraints (" << separation_count << " in total)" << std::endl;
+            
+            cp_model.ClearHints();
+            add_hints(candidate);
+            response = solve_round(round_seconds());
+        }
+        deadline.begin(Phase::Repair);
+        
+        std::cout << "Status: " << static_cast<int>(response.status()) << std::endl;
+        
+        result.formulation = per_student ? "student" : "exam";
+        result.model_variables = layout.num_variables();
+        
+        if (response.status() == CpSolverStatus::INFEASIBLE) {
+            result.status = "infeasible";
+            return true;
+        }
+        
+        // The objective bound is a valid lower bound on rooms even without a solution
+        if (response.status() != CpSolverStatus::MODEL_INVALID) {
+            result.lower_bound = std::max(result.lower_bound, rooms_bound(response.best_objective_bound()));
+        }
+        
+        if (response.status() != CpSolverStatus::OPTIMAL && 
+            response.status() != CpSolverStatus::FEASIBLE) {
+            return true;
+        }
+        
+        // Extract results
+        int seated = extract(response, candidate);
+        
+        std::cout << "C++ solver assigned " << seated << " students" << std::endl;
+        
+        // Keep the packing plan unless CP-SAT found a complete seating at least
+        // as good. A lazy run cut short by the time limit may still break separation.
+        int cpsat_rooms = count_rooms(problem, candidate);
+        bool separated = !lazy || find_violations(problem, shapes, shape_of, candidate, nullptr) == 0;
+        if (seated == problem.num_students && separated && (best.empty() || cpsat_rooms <= result.rooms_used)) {
+            best.swap(candidate);
+            result.rooms_used = cpsat_rooms;
+            result.engine = "cpsat";
+        }
+        
+        return true;
+    }
+    
+    // Publish an improving solution to the progress slot and the caller's callback
+    void publish_progress(
+        const SolveOptions& options,
+        std::chrono::high_resolution_clock::time_point start_time,
+        const std::string& engine,
+        int rooms_used,
+        int lower_bound,
+        const Seating& seating
+    ) {
+        ProgressUpdate update;
+        update.elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start_time
+        ).count();
+        update.rooms_used = rooms_used;
+        update.lower_bound = lower_bound;
+        update.engine = engine;
+        update.room_of.resize(seating.size());
+        update.row_of.resize(seating.size());
+        update.col_of.resize(seating.size());
+        for (size_t i = 0; i < seating.size(); i++) {
+            update.room_of[i] = seating[i].room;
+            update.row_of[i] = seating[i].room < 0 ? -1 : seating[i].row;
+            update.col_of[i] = seating[i].room < 0 ? -1 : seating[i].col;
+        }
+        
+        progress_.publish(std::move(update));
+        
+        if (options.on_progress) {
+            // A failing callback must not take the solver thread down with it
+            try {
+                options.on_progress(*progress_.latest());
+            } catch (const std::exception& e) {
+                std::cout << "Progress callback failed: " << e.what() << std::endl;
+            }
+        }
+    }
+    
+    // Rooms a seating uses, rooms holding pinned students included
+    int count_rooms(const Problem& problem, const Seating& seating) const {
+        std::vector<char> used(problem.num_rooms, 0);
+        int count = 0;
+        for (const auto& hold : problem.holds) {
+            if (used[hold.room]) continue;
+            used[hold.room] = 1;
+            count++;
+        }
+        for (const auto& seat : seating) {
+            if (seat.room < 0 || used[seat.room]) continue;
+            used[seat.room] = 1;
+            count++;
+        }
+        return count;
+    }
+    
+    // Exam-room pairs and fullest room of a seating, the quantities the
+    // secondary objective weighs
+    void measure_spread(
+        const Problem& problem,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of,
+        const Seating& seating,
+        SolveResult& result
+    ) const {
+        std::vector<int> load(problem.num_rooms, 0);
+        std::vector<int> last_exam(problem.num_rooms, -1);
+        result.exam_rooms = 0;
+        for (int e = 0; e < problem.num_exams; e++) {
+            for (const int32_t* i = problem.exam_begin(e); i != problem.exam_end(e); i++) {
+                int k = seating[*i].room;
+                if (k < 0) continue;
+                load[k]++;
+                if (last_exam[k] != e) {
+                    last_exam[k] = e;
+                    result.exam_rooms++;
+                }
+            }
+        }
+        
+        result.max_fill_percent = 0;
+        for (int k = 0; k < problem.num_rooms; k++) {
+            int seats = static_cast<int>(shapes[shape_of[k]].positions.size());
+            if (load[k] == 0 || seats == 0) continue;
+            result.max_fill_percent = std::max(result.max_fill_percent, (100 * load[k] + seats - 1) / seats);
+        }
+    }
+    
+    // Same-exam students on neighbouring seats, one entry per pair (first <
+    // second, as seat indices of the room). Appends to out if given and returns
+    // the number found; unseated students are ignored.
+    struct Violation {
+        int exam, room, first, second;
+    };
+    
+    int find_violations(
+        const Problem& problem,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of,
+        const Seating& seating,
+        std::vector<Violation>* out
+    ) const {
+        std::vector<std::vector<int32_t>> occupant(problem.num_rooms);  // seat -> exam, -1 if free
+        for (int i = 0; i < problem.num_students; i++) {
+            const SeatRef& s = seating[i];
+            if (s.room < 0) continue;
+            const auto& shape = shapes[shape_of[s.room]];
+            if (occupant[s.room].empty()) occupant[s.room].assign(shape.positions.size(), -1);
+            occupant[s.room][shape.cell[s.row * shape.cols + s.col]] = problem.exam_of[i];
+        }
+        
+        int count = 0;
+        for (int k = 0; k < problem.num_rooms; k++) {
+            const auto& seats = occupant[k];
+            const auto& shape = shapes[shape_of[k]];
+            for (int p = 0; p < static_cast<int>(seats.size()); p++) {
+                if (seats[p] < 0) continue;
+                for (int n = shape.neighbour_offset[p]; n < shape.neighbour_offset[p + 1]; n++) {
+                    int q = shape.neighbours[n];
+                    if (q <= p || seats[q] != seats[p]) continue;
+                    if (out) out->push_back({seats[p], k, p, q});
+                    count++;
+                }
+            }
+        }
+        return count;
+    }
+    
+    // Seats of pinned students, by index into students. A student with a
+    // single seat pin sits there. A student with room pins or several seat
+    // pins takes the first free seat among them that keeps separation from the
+    // students pinned so far, in a room that pins already use if there is one.
+    // Throws std::invalid_argument for unknown students, rooms or seats and
+    // for pins that collide or put an exam's students side by side.
+    std::vector<std::pair<int, SeatRef>> resolve_pins(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::vector<Pin>& pins,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of
+    ) const {
+        std::vector<std::pair<int, SeatRef>> placed;
+        if (pins.empty()) return placed;
         
-        for (const auto& room : rooms) {
-            std::vector<std::pair<int, int>> positions;
-            
-            for (int r = 0; r < room.rows; r++) {
-                if (room.skip_rows && r % 2 != 0) continue;
-                
-                for (int c = 0; c < room.cols; c++) {
-                    if (room.skip_cols && c % 2 != 0) continue;
-                    positions.push_back({r, c});
+        std::unordered_map<int, int> student_index;
+        for (size_t i = 0; i < students.size(); i++) student_index.emplace(students[i].id, static_cast<int>(i));
+        std::unordered_map<std::string_view, int> room_index;
+        for (size_t k = 0; k < rooms.size(); k++) room_index.emplace(rooms[k].id, static_cast<int>(k));
+        
+        // Choices per student in input order: (room, position), position -1 for any seat of the room
+        std::vector<int> order;
+        std::unordered_map<int, std::vector<std::pair<int, int>>> choices;
+        for (const auto& pin : pins) {
+            auto student = student_index.find(pin.student_id);
+            if (student == student_index.end()) {
+                throw std::invalid_argument("Pin for unknown student " + std::to_string(pin.student_id));
+            }
+            auto room = room_index.find(pin.room_id);
+            if (room == room_index.end()) {
+                throw std::invalid_argument("Pin of student " + std::to_string(pin.student_id) + 
+                                            " names unknown room " + pin.room_id);
+            }
+            int position = -1;
+            if (pin.row >= 0 || pin.col >= 0) {
+                const auto& shape = shapes[shape_of[room->second]];
+                if (pin.row < 0 || pin.row >= shape.rows || pin.col < 0 || pin.col >= shape.cols ||
+                    shape.cell[pin.row * shape.cols + pin.col] < 0) {
+                    throw std::invalid_argument("Pin of student " + std::to_string(pin.student_id) + ": (" + 
+                                                std::to_string(pin.row) + ", " + std::to_string(pin.col) + 
+                                                ") is not a seat of room " + pin.room_id);
                 }
+                position = shape.cell[pin.row * shape.cols + pin.col];
+            }
+            auto& list = choices[student->second];
+            if (list.empty()) order.push_back(student->second);
+            list.push_back({room->second, position});
+        }
+        
+        std::vector<std::vector<int>> holder(rooms.size());  // room -> seat -> pinned student, -1 if free
+        std::vector<char> in_use(rooms.size(), 0);
+        auto fits = [&](int i, int k, int p) {
+            const auto& shape = shapes[shape_of[k]];
+            auto& seats = holder[k];
+            if (seats.empty()) seats.assign(shape.positions.size(), -1);
+            if (seats[p] >= 0) return false;
+            for (int n = shape.neighbour_offset[p]; n < shape.neighbour_offset[p + 1]; n++) {
+                int j = seats[shape.neighbours[n]];
+                if (j >= 0 && students[j].exam == students[i].exam) return false;
+            }
+            return true;
+        };
+        auto take = [&](int i, int k, int p) {
+            holder[k][p] = i;
+            in_use[k] = 1;
+            const auto& pos = shapes[shape_of[k]].positions[p];
+            placed.push_back({i, SeatRef{k, pos.first, pos.second}});
+        };
+        
+        // Fixed seats first, so choices work around them
+        for (int i : order) {
+            const auto& list = choices[i];
+            if (list.size() != 1 || list[0].second < 0) continue;
+            if (!fits(i, list[0].first, list[0].second)) {
+                throw std::invalid_argument("Pin of student " + std::to_string(students[i].id) + 
+                                            ": seat is taken or next to a student of the same exam");
             }
+            take(i, list[0].first, list[0].second);
+        }
+        for (int i : order) {
+            const auto& list = choices[i];
+            if (list.size() == 1 && list[0].second >= 0) continue;
             
-            room_positions.push_back(positions);
-            std::cout << "Room " << room.id << ": " << positions.size() << " positions" << std::endl;
+            bool done = false;
+            for (int pass = 0; pass < 2 && !done; pass++) {
+                for (const auto& choice : list) {
+                    int k = choice.first;
+                    if (pass == 0 && !in_use[k]) continue;
+                    int from = choice.second >= 0 ? choice.second : 0;
+                    int to = choice.second >= 0 ? choice.second + 1 : static_cast<int>(shapes[shape_of[k]].positions.size());
+                    for (int p = from; p < to && !done; p++) {
+                        if (fits(i, k, p)) {
+                            take(i, k, p);
+                            done = true;
+                        }
+                    }
+                    if (done) break;
+                }
+            }
+            if (!done) {
+                throw std::invalid_argument("Pin of student " + std::to_string(students[i].id) + 
+                                            ": no free seat among its pinned rooms and seats");
+            }
+        }
+        return placed;
+    }
+    
+    // Seating of this request from assignments by ID. Students or rooms the
+    // assignments do not mention stay unseated. Returns the number placed.
+    int seat_assignments(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::vector<Assignment>& assignments,
+        Seating& seating
+    ) const {
+        std::unordered_map<int, int> student_index;
+        student_index.reserve(students.size());
+        for (size_t i = 0; i < students.size(); i++) student_index.emplace(students[i].id, static_cast<int>(i));
+        std::unordered_map<std::string_view, int> room_index;
+        for (size_t k = 0; k < rooms.size(); k++) room_index.emplace(rooms[k].id, static_cast<int>(k));
+        
+        seating.assign(students.size(), SeatRef());
+        int placed = 0;
+        for (const auto& a : assignments) {
+            auto student = student_index.find(a.student_id);
+            auto room = room_index.find(a.room_id);
+            if (student == student_index.end() || room == room_index.end()) continue;
+            seating[student->second] = {room->second, a.row, a.col};
+            placed++;
+        }
+        return placed;
+    }
+    
+    // A cached result for key that is as good as solving again: proven optimal,
+    // or found with at least the time budget asked for now. Memory first, then
+    // the cache directory.
+    std::optional<CachedSolve> cached_solve(const InstanceKey& key, const SolveOptions& options) {
+        SolutionCache& cache = solution_cache();
+        std::optional<CachedSolve> cached = cache.solved.get(key);
+        
+        std::string directory = cache.cache_directory();
+        if (!cached && !directory.empty()) {
+            if (auto bytes = load_cache_file(directory, key)) {
+                cached = decode_cached(*bytes);
+                if (cached) {
+                    cache.solved.put(key, *cached);
+                } else {
+                    std::cout << "Ignoring unreadable cache file for " << key.hex() << std::endl;
+                }
+            }
         }
         
-        return room_positions;
+        if (cached && (cached->result.gap == 0 || cached->timeout_seconds >= options.timeout_seconds)) {
+            cache.hits++;
+            return cached;
+        }
+        cache.misses++;
+        return std::nullopt;
     }
     
-    bool is_adjacent(const std::pair<int, int>& pos1, const std::pair<int, int>& pos2) {
-        return std::abs(pos1.first - pos2.first) + std::abs(pos1.second - pos2.second) == 1;
+    SolveResult answer_from_cache(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const SolveOptions& options,
+        std::chrono::high_resolution_clock::time_point start_time,
+        CachedSolve cached,
+        const std::string& instance_key
+    ) {
+        SolveResult result = std::move(cached.result);
+        result.cached = true;
+        result.instance_key = instance_key;
+        
+        std::pmr::monotonic_buffer_resource arena(arena_bytes(students.size(), 0));
+        Seating seating(&arena);
+        seat_assignments(students, rooms, result.assignments, seating);
+        publish_progress(options, start_time, result.engine, result.rooms_used, result.lower_bound, seating);
+        
+        result.solve_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start_time
+        ).count();
+        result.peak_rss_mb = peak_rss_mb();
+        std::cout << "C++ solver answered from cache " << instance_key << ": " << result.status 
+                  << ", rooms " << result.rooms_used << ", gap " << result.gap << std::endl;
+        return result;
     }
-
-public:
-    std::vector<Assignment> solve(
+    
+    // Last seating of the same rooms, restrictions and separation, restricted
+    // to the students of this request that still fit the seat they had
+    void warm_seating(
         const std::vector<Student>& students,
         const std::vector<Room>& rooms,
         const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
-        int timeout_seconds = 120
+        const SolveOptions& options,
+        const std::vector<RoomShape>& shapes,
+        const std::vector<int>& shape_of,
+        Seating& seating
     ) {
-        auto start_time = std::chrono::high_resolution_clock::now();
+        auto assignments = solution_cache().warm.get(layout_key(rooms, restrictions, options));
+        if (!assignments) return;
         
-        std::cout << "Starting C++ solver with " << students.size() << " students and " 
-                  << rooms.size() << " rooms" << std::endl;
+        int placed = seat_assignments(students, rooms, *assignments, seating);
+        for (auto& seat : seating) {
+            if (seat.room < 0) continue;
+            const auto& shape = shapes[shape_of[seat.room]];
+            if (seat.row < 0 || seat.row >= shape.rows || seat.col < 0 || seat.col >= shape.cols ||
+                shape.cell[seat.row * shape.cols + seat.col] < 0) {
+                seat = SeatRef();
+                placed--;
+            }
+        }
+        if (placed == 0) {
+            seating.clear();
+            return;
+        }
+        std::cout << "Warm start from a cached seating of the same rooms: " << placed 
+                  << " of " << students.size() << " students" << std::endl;
+    }
+    
+    void remember(const InstanceKey& key, const InstanceKey& rooms_key, const SolveOptions& options, 
+                  const SolveResult& result) {
+        SolutionCache& cache = solution_cache();
+        CachedSolve cached;
+        cached.result = result;
+        cached.result.cached = false;
+        cached.result.solve_ms = 0;
+        cached.result.peak_rss_mb = 0;
+        cached.timeout_seconds = options.timeout_seconds;
         
-        CpModelBuilder cp_model;
+        std::string directory = cache.cache_directory();
+        if (!directory.empty() && !store_cache_file(directory, key, encode_cached(cached))) {
+            std::cout << "Could not write cache file for " << key.hex() << " to " << directory << std::endl;
+        }
+        cache.warm.put(rooms_key, result.assignments);
+        cache.solved.put(key, std::move(cached));
+    }
+    
+    // Each component solved as a request of its own on the task pool,
+    // largest first, then merged. Components share no room, so the merged
+    // seating is valid when every part is, and rooms, bounds and gaps add up.
+    // Pinned students go with the component of their room, as seat pins;
+    // those in rooms no component uses are added at the end.
+    SolveResult solve_components(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+        const Problem& problem,
+        const std::vector<Student>& free_students,
+        const std::vector<std::pair<int, SeatRef>>& pinned,
+        const std::vector<Component>& components,
+        const SolveOptions& options,
+        std::chrono::high_resolution_clock::time_point start_time,
+        const Deadline& deadline
+    ) {
+        const size_t count = components.size();
+        std::cout << "Decomposed into " << count << " independent components, largest " 
+                  << components[0].students << " students and " << components[0].rooms.size() 
+                  << " rooms" << std::endl;
         
-        // Precompute room positions
-        auto room_positions = precompute_positions(rooms);
+        // Sub-requests keep students and rooms in input order
+        std::vector<int> component_of_exam(problem.num_exams, -1);
+        for (size_t c = 0; c < count; c++) {
+            for (int e : components[c].exams) component_of_exam[e] = static_cast<int>(c);
+        }
+        std::vector<std::vector<Student>> sub_students(count);
+        for (int i = 0; i < problem.num_students; i++) {
+            sub_students[component_of_exam[problem.exam_of[i]]].push_back(free_students[i]);
+        }
+        std::vector<int> component_of_room(rooms.size(), -1);
+        for (size_t c = 0; c < count; c++) {
+            for (int k : components[c].rooms) component_of_room[k] = static_cast<int>(c);
+        }
+        std::vector<std::vector<Pin>> sub_pins(count);
+        std::vector<std::pair<int, SeatRef>> outside;  // pinned in rooms of no component
+        for (const auto& pin : pinned) {
+            int c = component_of_room[pin.second.room];
+            if (c < 0) {
+                outside.push_back(pin);
+                continue;
+            }
+            const Student& student = students[pin.first];
+            sub_students[c].push_back(student);
+            sub_pins[c].emplace_back(student.id, rooms[pin.second.room].id, pin.second.row, pin.second.col);
+        }
+        std::vector<std::vector<Room>> sub_rooms(count);
+        std::vector<std::unordered_map<std::string, std::vector<std::string>>> sub_restrictions(count);
+        for (size_t c = 0; c < count; c++) {
+            std::unordered_set<std::string_view> room_ids;
+            for (int k : components[c].rooms) {
+                sub_rooms[c].push_back(rooms[k]);
+                room_ids.insert(rooms[k].id);
+            }
+            for (int e : components[c].exams) {
+                if (!problem.restricted[e]) continue;
+                auto it = restrictions.find(std::string(problem.exams.name(e)));
+                auto& allowed = sub_restrictions[c][it->first];
+                for (const auto& room_id : it->second) {
+                    if (room_ids.count(room_id)) allowed.push_back(room_id);
+                }
+            }
+        }
         
-        // Calculate total capacity
-        int total_capacity = 0;
-        for (const auto& positions : room_positions) {
-            total_capacity += positions.size();
+        std::vector<SolveOptions> component_options(count, options);
+        for (size_t c = 0; c < count; c++) {
+            component_options[c].decompose = false;
+            component_options[c].on_progress = nullptr;
+            component_options[c].pins = std::move(sub_pins[c]);
         }
         
-        std::cout << "Total capacity: " << total_capacity << ", Students: " << students.size() << std::endl;
+        std::vector<FastSeatingOptimizer> solvers(count);
+        std::vector<SolveResult> results(count);
+        {
+            std::lock_guard<std::mutex> lock(components_mutex_);
+            for (auto& solver : solvers) {
+                components_.push_back(&solver);
+                if (stop_requested_) solver.stop();
+            }
+        }
         
-        if (total_capacity < static_cast<int>(students.size())) {
-            std::cout << "ERROR: Not enough capacity!" << std::endl;
-            return {};
+        int threads = task_pool().width(options.num_threads, count);
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t c = next++; c < count; c = next++) {
+                results[c] = solvers[c].solve_request(sub_students[c], sub_rooms[c], sub_restrictions[c], 
+                                                      component_options[c], deadline);
+            }
+        };
+        try {
+            task_pool().run(threads, worker);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(components_mutex_);
+            components_.clear();
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> lock(components_mutex_);
+            components_.clear();
         }
         
-        // Build exam groupings
-        std::unordered_map<std::string, std::vector<int>> exam_to_students;
-        std::unordered_map<int, std::string> exam_of;
+        // The weakest part decides the status: infeasible, invalid, unknown,
+        // then feasible, and optimal only if every part is
+        auto weakness = [](const std::string& status) {
+            if (status == "infeasible") return 3;
+            if (status == "invalid") return 2;
+            if (status == "optimal") return 0;
+            return status == "feasible" ? 0 : 1;
+        };
         
-        for (const auto& student : students) {
-            exam_to_students[student.exam].push_back(student.id);
-            exam_of[student.id] = student.exam;
+        SolveResult merged;
+        std::set<std::string> engines, formulations;
+        std::string weakest = "optimal";
+        bool all_optimal = true;
+        merged.valid = true;
+        for (const auto& part : results) {
+            merged.assignments.insert(merged.assignments.end(), part.assignments.begin(), part.assignments.end());
+            merged.rooms_used += part.rooms_used;
+            merged.lower_bound += part.lower_bound;
+            merged.model_variables += part.model_variables;
+            merged.exam_rooms += part.exam_rooms;
+            merged.max_fill_percent = std::max(merged.max_fill_percent, part.max_fill_percent);
+            merged.valid = merged.valid && part.valid;
+            if (!part.engine.empty()) engines.insert(part.engine);
+            if (!part.formulation.empty()) formulations.insert(part.formulation);
+            all_optimal = all_optimal && part.status == "optimal";
+            if (weakness(part.status) > weakness(weakest)) weakest = part.status;
+        }
+        std::set<int> outside_rooms;
+        for (const auto& pin : outside) {
+            merged.assignments.emplace_back(students[pin.first].id, rooms[pin.second.room].id, 
+                                            pin.second.row, pin.second.col);
+            outside_rooms.insert(pin.second.room);
+        }
+        merged.rooms_used += static_cast<int>(outside_rooms.size());
+        merged.lower_bound += static_cast<int>(outside_rooms.size());
+        merged.status = weakness(weakest) > 0 ? weakest : (all_optimal ? "optimal" : "feasible");
+        merged.gap = merged.rooms_used - merged.lower_bound;
+        for (const auto& engine : engines) merged.engine += (merged.engine.empty() ? "" : "+") + engine;
+        for (const auto& name : formulations) merged.formulation += (merged.formulation.empty() ? "" : "+") + name;
+        
+        if (merged.valid) {
+            std::pmr::monotonic_buffer_resource arena(arena_bytes(students.size(), 0));
+            Seating seating(&arena);
+            seat_assignments(students, rooms, merged.assignments, seating);
+            publish_progress(options, start_time, merged.engine, merged.rooms_used, merged.lower_bound, seating);
         }
         
-        // Create variables - using string keys for simplicity
-        std::unordered_map<std::string, BoolVar> x;
-        std::vector<BoolVar> y; // room usage variables
+        merged.solve_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now() - start_time
+        ).count();
+        merged.peak_rss_mb = peak_rss_mb();
+        std::cout << "C++ solver completed " << count << " components in " << merged.solve_ms << "ms: " 
+                  << merged.status << ", rooms " << merged.rooms_used << ", lower bound " << merged.lower_bound 
+                  << ", gap " << merged.gap << std::endl;
+        return merged;
+    }
+    
+    // Back to the public representation with student and room IDs
+    std::vector<Assignment> to_assignments(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const Seating& seating
+    ) {
+        std::vector<Assignment> assignments;
+        assignments.reserve(seating.size());
+        for (size_t i = 0; i < seating.size(); i++) {
+            if (seating[i].room < 0) continue;
+            assignments.emplace_back(students[i].id, rooms[seating[i].room].id, seating[i].row, seating[i].col);
+        }
+        return assignments;
+    }
+
+public:
+    // Room-level plan from bin packing, without building the CP-SAT model
+    RoomPlan plan_rooms(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+        const Separation& separation = Separation()
+    ) {
+        std::pmr::monotonic_buffer_resource arena(arena_bytes(students.size(), rooms.size()));
+        Problem problem = build_problem(students, rooms, restrictions, &arena);
         
-        // Create room usage variables
+        std::vector<int> shape_of;
+        auto shapes = build_shape_classes(rooms, separation, shape_of);
+        std::vector<int> seats_per_room(rooms.size());
         for (size_t ki = 0; ki < rooms.size(); ki++) {
-            y.push_back(cp_model.NewBoolVar());
+            seats_per_room[ki] = static_cast<int>(shapes[shape_of[ki]].positions.size());
+        }
+        SeatCatalogue catalogue = build_seat_catalogue(problem, seats_per_room, &arena);
+        Seating seating(&arena);
+        RoomPlan plan = pack_rooms(problem, students, rooms, shapes, shape_of, catalogue, seating);
+        plan.assignments = to_assignments(students, rooms, seating);
+        return plan;
+    }
+    
+    // Solve in the requested mode and report rooms used, a certified lower
+    // bound on rooms and the gap between them.
+    //   "packing": bin packing plan only, greedy if the plan is incomplete
+    //   "greedy":  seat-by-seat greedy only
+    //   "cpsat":   CP-SAT model, warm started from the packing plan
+    //   "auto":    packing, then CP-SAT only if the gap is not zero
+    // Requests whose restrictions split them into independent components are
+    // solved one component at a time, in parallel, unless options.decompose is off.
+    // options.timeout_seconds is the budget of the whole call, see Deadline.
+    SolveResult run(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+        const SolveOptions& options
+    ) {
+        return run_until(students, rooms, restrictions, options, Deadline(options.timeout_seconds));
+    }
+    
+    // run() on a request body from parse_assign_request. The body's
+    // separation and pins take the place of those in options, and the time
+    // spent parsing it counts against options.timeout_seconds.
+    SolveResult run_request(const AssignRequestData& request, SolveOptions options) {
+        const RequestStudents& columns = request.students;
+        std::vector<Student> students;
+        students.reserve(columns.size());
+        for (size_t i = 0; i < columns.size(); i++) {
+            students.emplace_back(columns.file_number[i], std::string(columns.course_code[i]));
         }
         
-        // Create student assignment variables
-        int variable_count = 0;
-        for (const auto& student : students) {
-            const std::string& exam = student.exam;
-            
-            for (size_t ki = 0; ki < rooms.size(); ki++) {
-                // Check restrictions
-                if (restrictions.find(exam) != restrictions.end()) {
-                    const auto& allowed_rooms = restrictions.at(exam);
-                    if (std::find(allowed_rooms.begin(), allowed_rooms.end(), rooms[ki].id) 
-                        == allowed_rooms.end()) {
-                        continue; // Skip this room for this exam
-                    }
-                }
-                
-                for (const auto& pos : room_positions[ki]) {
-                    std::string var_key = std::to_string(student.id) + "_" + 
-                                        std::to_string(ki) + "_" + 
-                                        std::to_string(pos.first) + "_" + 
-                                        std::to_string(pos.second);
-                    x[var_key] = cp_model.NewBoolVar();
-                    variable_count++;
-                }
+        std::vector<Room> rooms;
+        rooms.reserve(request.rooms.size());
+        for (const auto& room : request.rooms) {
+            if (!room.seat_mask.empty()) {
+                rooms.push_back(Room::from_mask(room.room_id, room.seat_mask, room.adjacency));
+            } else {
+                rooms.emplace_back(room.room_id, room.rows, room.cols, room.skip_rows, room.skip_cols);
+            }
+        }
+        
+        if (request.separation) options.separation = *request.separation;
+        for (const auto& pin : request.pins) {
+            options.pins.emplace_back(pin.file_number, pin.room_id, pin.row, pin.col);
+        }
+        auto parsed_from = Deadline::Clock::now() - std::chrono::duration_cast<Deadline::Clock::duration>(
+            std::chrono::duration<double>(request.parse_seconds));
+        Deadline deadline(options.timeout_seconds, parsed_from);
+        return run_until(students, rooms, request.restrictions, options, deadline);
+    }
+
+private:
+    SolveResult run_until(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+        const SolveOptions& options,
+        Deadline deadline
+    ) {
+        progress_.reset();
+        stop_requested_ = false;
+        if (cancelled_) stop_requested_ = true;
+        return solve_request(students, rooms, restrictions, options, deadline);
+    }
+    
+    // run() without resetting the stop flag, so a component solver stopped
+    // before it starts stays stopped
+    SolveResult solve_request(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+        const SolveOptions& options,
+        Deadline deadline
+    ) {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        deadline.begin(Phase::Presolve);
+        SolveResult result;
+        
+        std::cout << "Starting C++ solver (" << options.mode << ") with " << students.size() 
+                  << " students and " << rooms.size() << " rooms" << std::endl;
+        
+        InstanceKey key;
+        if (options.use_cache) {
+            key = instance_key(students, rooms, restrictions, options);
+            result.instance_key = key.hex();
+            if (auto cached = cached_solve(key, options)) {
+                return answer_from_cache(students, rooms, options, start_time, std::move(*cached), result.instance_key);
             }
         }
         
-        std::cout << "Created " << variable_count << " variables" << std::endl;
+        // Precompute positions and adjacency once per room shape
+        std::vector<int> shape_of;
+        auto shapes = build_shape_classes(rooms, options.separation, shape_of);
         
-        // Constraint 1: Each student sits exactly once
-        for (const auto& student : students) {
-            std::vector<BoolVar> student_vars;
-            
-            for (size_t ki = 0; ki < rooms.size(); ki++) {
-                for (const auto& pos : room_positions[ki]) {
-                    std::string var_key = std::to_string(student.id) + "_" + 
-                                        std::to_string(ki) + "_" + 
-                                        std::to_string(pos.first) + "_" + 
-                                        std::to_string(pos.second);
-                    
-                    if (x.find(var_key) != x.end()) {
-                        student_vars.push_back(x[var_key]);
-                    }
-                }
+        // Pinned students are seated up front and leave the problem; what is
+        // left is solved around the seats they hold
+        auto pinned = resolve_pins(students, rooms, options.pins, shapes, shape_of);
+        std::vector<Student> unpinned;
+        if (!pinned.empty()) {
+            std::vector<char> is_pinned(students.size(), 0);
+            for (const auto& pin : pinned) is_pinned[pin.first] = 1;
+            for (size_t i = 0; i < students.size(); i++) {
+                if (!is_pinned[i]) unpinned.push_back(students[i]);
             }
-            
-            if (!student_vars.empty()) {
-                cp_model.AddEquality(LinearExpr::Sum(student_vars), 1);
+            std::cout << "Pinned " << pinned.size() << " students" << std::endl;
+        }
+        const std::vector<Student>& free_students = pinned.empty() ? students : unpinned;
+        
+        // Every transient structure of this solve lives in one arena owned by
+        // this call, released in one go when it returns
+        std::pmr::monotonic_buffer_resource arena(arena_bytes(students.size(), rooms.size()));
+        Problem problem = build_problem(free_students, rooms, restrictions, &arena);
+        for (const auto& pin : pinned) {
+            const auto& shape = shapes[shape_of[pin.second.room]];
+            problem.holds.push_back({pin.second.room, shape.cell[pin.second.row * shape.cols + pin.second.col],
+                                     problem.exams.find(students[pin.first].exam)});
+        }
+        Seating best(&arena);  // best complete seating so far, empty if none
+        
+        // Pinned students join the reported seating. Their rooms are open in
+        // every stage, so rooms_used and the lower bound count them already.
+        auto add_pinned = [&]() {
+            if (pinned.empty() || (best.empty() && !free_students.empty())) return;
+            for (const auto& pin : pinned) {
+                const SeatRef& seat = pin.second;
+                result.assignments.emplace_back(students[pin.first].id, rooms[seat.room].id, seat.row, seat.col);
             }
+        };
+        
+        auto finish = [&]() {
+            result.assignments = to_assignments(free_students, rooms, best);
+            add_pinned();
+            result.solve_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::high_resolution_clock::now() - start_time
+            ).count();
+            result.peak_rss_mb = peak_rss_mb();
+            std::cout << "C++ solver completed in " << result.solve_ms << "ms: " << result.status 
+                      << ", rooms " << result.rooms_used << ", lower bound " << result.lower_bound 
+                      << ", gap " << result.gap << ", peak RSS " << result.peak_rss_mb << " MB" << std::endl;
+            std::cout << "Time budget: " << deadline.summary() << " of " 
+                      << options.timeout_seconds << " s" << std::endl;
+            return result;
+        };
+        
+        if (!pinned.empty() && free_students.empty()) {
+            std::set<int> pinned_rooms;
+            for (const auto& pin : pinned) pinned_rooms.insert(pin.second.room);
+            result.rooms_used = result.lower_bound = static_cast<int>(pinned_rooms.size());
+            result.engine = "pins";
+            result.valid = true;
+            result.status = "optimal";
+            return finish();
         }
         
-        // Constraint 2: No double booking + room usage linking
-        for (size_t ki = 0; ki < rooms.size(); ki++) {
-            for (const auto& pos : room_positions[ki]) {
-                std::vector<BoolVar> seat_vars;
-                
-                for (const auto& student : students) {
-                    std::string var_key = std::to_string(student.id) + "_" + 
-                                        std::to_string(ki) + "_" + 
-                                        std::to_string(pos.first) + "_" + 
-                                        std::to_string(pos.second);
-                    
-                    if (x.find(var_key) != x.end()) {
-                        seat_vars.push_back(x[var_key]);
-                        // Link to room usage
-                        cp_model.AddLessOrEqual(x[var_key], y[ki]);
-                    }
-                }
-                
-                if (!seat_vars.empty()) {
-                    cp_model.AddLessOrEqual(LinearExpr::Sum(seat_vars), 1);
+        if (options.decompose) {
+            auto components = find_components(problem);
+            if (components.size() > 1) {
+                SolveResult merged = solve_components(students, rooms, restrictions, problem, free_students, 
+                                                      pinned, components, options, start_time, deadline);
+                if (options.use_cache && merged.valid) {
+                    remember(key, layout_key(rooms, restrictions, options), options, merged);
                 }
+                merged.instance_key = result.instance_key;
+                return merged;
             }
         }
         
-        // Constraint 3: Separation constraints (optimized)
-        int separation_count = 0;
-        const int MAX_SEPARATION_CONSTRAINTS = 50000; // Limit to prevent explosion
+        // Restrictions compiled to seat masks over the whole catalogue
+        std::vector<int> seats_per_room(rooms.size());
+        for (size_t ki = 0; ki < rooms.size(); ki++) {
+            seats_per_room[ki] = static_cast<int>(shapes[shape_of[ki]].positions.size());
+        }
+        SeatCatalogue catalogue = build_seat_catalogue(problem, seats_per_room, &arena);
+        int total_capacity = catalogue.total_seats;
         
-        for (const auto& exam_group : exam_to_students) {
-            if (exam_group.second.size() < 2) continue;
-            
-            const auto& studs = exam_group.second;
-            
-            for (size_t ki = 0; ki < rooms.size(); ki++) {
-                const auto& positions = room_positions[ki];
-                
-                // Find adjacent pairs
-                for (size_t i = 0; i < positions.size() && separation_count < MAX_SEPARATION_CONSTRAINTS; i++) {
-                    for (size_t j = i + 1; j < positions.size() && separation_count < MAX_SEPARATION_CONSTRAINTS; j++) {
-                        if (!is_adjacent(positions[i], positions[j])) continue;
-                        
-                        // Add constraints for all student pairs in same exam
-                        for (size_t si = 0; si < studs.size() && separation_count < MAX_SEPARATION_CONSTRAINTS; si++) {
-                            for (size_t sj = si + 1; sj < studs.size() && separation_count < MAX_SEPARATION_CONSTRAINTS; sj++) {
-                                std::string var1 = std::to_string(studs[si]) + "_" + 
-                                                 std::to_string(ki) + "_" + 
-                                                 std::to_string(positions[i].first) + "_" + 
-                                                 std::to_string(positions[i].second);
-                                
-                                std::string var2 = std::to_string(studs[sj]) + "_" + 
-                                                 std::to_string(ki) + "_" + 
-                                                 std::to_string(positions[j].first) + "_" + 
-                                                 std::to_string(positions[j].second);
-                                
-                                if (x.find(var1) != x.end() && x.find(var2) != x.end()) {
-                                    cp_model.AddLessOrEqual(LinearExpr::Sum({x[var1], x[var2]}), 1);
-                                    separation_count++;
-                                }
-                            }
-                        }
-                    }
-                }
+        // Seats of pinned students are closed to every exam, their neighbours
+        // to the pinned student's exam
+        for (const auto& hold : problem.holds) {
+            const auto& shape = shapes[shape_of[hold.room]];
+            catalogue.close_seat(catalogue.seat(hold.room, hold.position));
+            total_capacity--;
+            if (hold.exam < 0) continue;
+            for (int n = shape.neighbour_offset[hold.position]; n < shape.neighbour_offset[hold.position + 1]; n++) {
+                catalogue.close_seat(hold.exam, catalogue.seat(hold.room, shape.neighbours[n]));
             }
         }
         
-        std::cout << "Added " << separation_count << " separation constraints" << std::endl;
+        std::cout << "Total capacity: " << total_capacity << ", Students: " << free_students.size() << std::endl;
         
-        // Objective: minimize rooms used
-        cp_model.Minimize(LinearExpr::Sum(y));
+        if (total_capacity < static_cast<int>(free_students.size())) {
+            std::cout << "ERROR: Not enough capacity!" << std::endl;
+            result.status = "infeasible";
+            return finish();
+        }
         
-        // Solve
-        CpSolver solver;
-        solver.GetMutableParameters()->set_max_time_in_seconds(timeout_seconds);
-        solver.GetMutableParameters()->set_num_search_workers(4);
-        solver.GetMutableParameters()->set_search_branching(SatParameters::PORTFOLIO_SEARCH);
-        solver.GetMutableParameters()->set_cp_model_presolve(true);
+        // An exam whose allowed seats cannot hold it makes the request infeasible
+        for (int e = 0; e < problem.num_exams; e++) {
+            if (count_bits(catalogue.exam_row(e), catalogue.words) < problem.exam_size(e)) {
+                std::cout << "ERROR: Not enough allowed seats for " << problem.exams.name(e) << "!" << std::endl;
+                result.status = "infeasible";
+                return finish();
+            }
+        }
         
-        std::cout << "Starting C++ solver..." << std::endl;
-        const CpSolverResponse response = solver.Solve(cp_model.Build());
+        // Room-level packing: a quick complete plan and a certified lower bound
+        Seating plan_seating(&arena);
+        RoomPlan plan = pack_rooms(problem, free_students, rooms, shapes, shape_of, catalogue, plan_seating,
+                                   deadline.phase_end());
+        result.lower_bound = plan.lower_bound;
         
-        auto solve_time = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::high_resolution_clock::now() - start_time
-        ).count();
+        if (plan.lower_bound < 0) {
+            std::cout << "ERROR: No valid seating exists under these restrictions!" << std::endl;
+            result.lower_bound = 0;
+            result.status = "infeasible";
+            return finish();
+        }
         
-        std::cout << "C++ solver completed in " << solve_time << "ms" << std::endl;
-        std::cout << "Status: " << static_cast<int>(response.status()) << std::endl;
+        if (plan.complete && options.mode != "greedy") {
+            best = plan_seating;
+            result.rooms_used = plan.rooms_used;
+            result.engine = "packing";
+            publish_progress(options, start_time, "packing", plan.rooms_used, plan.lower_bound, plan_seating);
+        }
         
-        // Extract results
-        std::vector<Assignment> assignments;
+        // Seat-by-seat greedy when the packing plan is incomplete, on request,
+        // or when restarts were asked for and might beat the plan
+        if (best.empty() || options.greedy_starts > 1) {
+            if (options.mode == "greedy") deadline.begin(Phase::Search);
+            GreedyRun greedy = multistart_greedy(problem, shapes, shape_of, options, deadline.phase_end());
+            if (greedy.start >= 0 && (best.empty() || greedy.rooms_used < result.rooms_used)) {
+                best.assign(greedy.seating.begin(), greedy.seating.end());
+                result.rooms_used = greedy.rooms_used;
+                result.engine = "greedy";
+                result.seed = greedy.seed;
+                publish_progress(options, start_time, "greedy", result.rooms_used, plan.lower_bound, best);
+            }
+        }
+        
+        bool secondary = options.spread_weight > 0 || options.balance_weight > 0;
+        bool good_enough = !best.empty() && !secondary && result.rooms_used - plan.lower_bound <= options.accept_gap;
         
-        if (response.status() == CpSolverStatus::OPTIMAL || 
-            response.status() == CpSolverStatus::FEASIBLE) {
+        bool run_cpsat = options.mode == "cpsat" || (options.mode == "auto" && !good_enough);
+        
+        if (run_cpsat) {
+            deadline.begin(Phase::Build);
+            auto groups = symmetric_room_groups(problem, shapes);
             
-            for (const auto& student : students) {
-                for (size_t ki = 0; ki < rooms.size(); ki++) {
-                    for (const auto& pos : room_positions[ki]) {
-                        std::string var_key = std::to_string(student.id) + "_" + 
-                                            std::to_string(ki) + "_" + 
-                                            std::to_string(pos.first) + "_" + 
-                                            std::to_string(pos.second);
-                        
-                        if (x.find(var_key) != x.end() && 
-                            SolutionBooleanValue(response, x[var_key])) {
-                            assignments.emplace_back(student.id, rooms[ki].id, pos.first, pos.second);
-                            break;
-                        }
-                    }
+            // With earlier rooms of a group opened first, no seating as good as the
+            // packing plan uses a room at position rooms_used or later in its group
+            std::vector<char> pruned(rooms.size(), 0);
+            if (plan.complete) {
+                for (const auto& group : groups) {
+                    for (size_t g = plan.rooms_used; g < group.size(); g++) pruned[group[g]] = 1;
+                }
+            }
+            
+            CandidateLayout layout = build_candidates(problem, catalogue, pruned, &arena);
+            
+            // Start from the last seating of the same rooms if there is one,
+            // else from the packing plan
+            Seating hint_seating(&arena);
+            if (options.use_cache) {
+                warm_seating(free_students, rooms, restrictions, options, shapes, shape_of, hint_seating);
+            }
+            if (hint_seating.empty() && plan.complete) {
+                hint_seating = plan_seating;
+            }
+            
+            std::vector<bool> formulations;  // per_student flags, most detailed first
+            if (options.formulation == "student") formulations.push_back(true);
+            formulations.push_back(false);
+            
+            bool solved = false;
+            for (bool per_student : formulations) {
+                layout_rows(layout, problem, per_student);
+                const char* name = per_student ? "student" : "exam";
+                
+                double estimate = estimate_model_mb(problem, layout, shapes, shape_of, per_student, secondary);
+                double available = options.memory_limit_mb - current_rss_mb();
+                std::cout << "Estimated " << name << " model: " << layout.num_variables() 
+                          << " variables, " << estimate << " MB" << std::endl;
+                
+                if (layout.num_variables() >= INT_MAX - static_cast<int64_t>(rooms.size()) ||
+                    (options.memory_limit_mb > 0 && estimate > available)) {
+                    std::cout << "The " << name << " formulation does not fit, falling back" << std::endl;
+                    continue;
+                }
+                if (solve_cpsat(problem, shapes, shape_of, groups, layout, per_student, plan, hint_seating,
+                                options, start_time, deadline, &arena, best, result)) {
+                    solved = true;
+                    break;
                 }
             }
             
-            std::cout << "C++ solver assigned " << assignments.size() << " students" << std::endl;
+            if (!solved) {
+                std::cout << "No CP-SAT model fits the memory ceiling and build budget, keeping the " 
+                          << (best.empty() ? "empty seating" : result.engine + " seating") << std::endl;
+            }
+        } else if (options.mode == "auto") {
+            std::cout << "Packing plan is within the accepted gap, skipping CP-SAT" << std::endl;
         }
         
-        return assignments;
+        deadline.begin(Phase::Verify);
+        if (!best.empty()) {
+            result.valid = verify_seating(problem, catalogue, shapes, shape_of, best, &arena);
+            measure_spread(problem, shapes, shape_of, best, result);
+            result.gap = result.rooms_used - result.lower_bound;
+            if (!result.valid) {
+                result.status = "invalid";
+            } else {
+                result.status = result.gap == 0 ? "optimal" : "feasible";
+            }
+        }
+        
+        SolveResult done = finish();
+        if (options.use_cache && done.valid) {
+            remember(key, layout_key(rooms, restrictions, options), options, done);
+        }
+        return done;
+    }
+    
+public:
+    // Latest improving solution of the current or last run, safe to poll from
+    // another thread while run() is working
+    std::optional<ProgressUpdate> progress() const {
+        auto latest = progress_.latest();
+        if (!latest) return std::nullopt;
+        return *latest;
+    }
+    
+    long long progress_sequence() const {
+        return progress_.sequence();
+    }
+    
+    // Ask the running search to return its best solution so far
+    void stop() {
+        stop_requested_ = true;
+        std::lock_guard<std::mutex> lock(components_mutex_);
+        for (auto* component : components_) component->stop();
+    }
+    
+    // stop() that also holds for runs not yet started, for an optimizer
+    // that is used once and may be cancelled before its run begins
+    void cancel() {
+        cancelled_ = true;
+        stop();
+    }
+    
+    std::vector<Assignment> solve(
+        const std::vector<Student>& students,
+        const std::vector<Room>& rooms,
+        const std::unordered_map<std::string, std::vector<std::string>>& restrictions,
+        int timeout_seconds = 120
+    ) {
+        SolveOptions options;
+        options.timeout_seconds = timeout_seconds;
+        return run(students, rooms, restrictions, options).assignments;
+    }
+};
+
+#ifndef FAST_SOLVER_NO_PYTHON
+// A solve on a native thread of its own, for asyncio callers. The call
+// returns at once; when the solve ends, on_done(value, error) is called from
+// that thread with the GIL held, error being None or the exception the
+// blocking call would have raised. No Python thread waits in the meantime:
+// fast_app hands on_done to loop.call_soon_threadsafe to complete a future.
+//
+// Every job's thread is kept in a registry. At interpreter exit an atexit
+// hook stops the jobs still running and joins their threads before
+// finalisation, so no thread takes the GIL of a finalising interpreter;
+// a job ending after that point drops its callback without calling it.
+class BackgroundSolve {
+private:
+    FastSeatingOptimizer solver_;
+    std::atomic<bool> done_{false};
+    std::atomic<bool> finished_{false};  // the thread is past any Python work
+
+    struct Registry {
+        std::mutex mutex;
+        bool shutting_down = false;
+        std::vector<std::pair<std::shared_ptr<BackgroundSolve>, std::thread>> jobs;
+    };
+
+    // Never destroyed, so a registry left unjoined cannot terminate the process at exit
+    static Registry& registry() {
+        static Registry* jobs = new Registry();
+        return *jobs;
+    }
+
+public:
+    void stop() { solver_.cancel(); }
+    bool done() const { return done_.load(); }
+    std::optional<ProgressUpdate> progress() const { return solver_.progress(); }
+    long long progress_sequence() const { return solver_.progress_sequence(); }
+    
+    // work(solver) runs without the GIL; its value is converted under it
+    template <class Work>
+    static std::shared_ptr<BackgroundSolve> start(pybind11::function on_done, Work work) {
+        auto job = std::make_shared<BackgroundSolve>();
+        Registry& jobs = registry();
+        std::lock_guard<std::mutex> lock(jobs.mutex);
+        if (jobs.shutting_down) throw std::runtime_error("fast_solver is shutting down");
+        
+        // Reap jobs whose threads are done; their joins return at once
+        auto reaped = std::remove_if(jobs.jobs.begin(), jobs.jobs.end(), [](auto& entry) {
+            if (!entry.first->finished_) return false;
+            entry.second.join();
+            return true;
+        });
+        jobs.jobs.erase(reaped, jobs.jobs.end());
+        
+        std::thread thread([job, on_done, work]() mutable {
+            using Value = decltype(work(job->solver_));
+            std::optional<Value> value;
+            PyObject* error_type = PyExc_RuntimeError;
+            std::string error;
+            try {
+                value.emplace(work(job->solver_));
+            } catch (const std::invalid_argument& e) {
+                error_type = PyExc_ValueError;
+                error = e.what();
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            job->done_ = true;
+            
+            bool deliver;
+            {
+                std::lock_guard<std::mutex> lock(registry().mutex);
+                deliver = !registry().shutting_down;
+            }
+            if (deliver) {
+                // Before the exit hook returns: it waits for this thread
+                // with the GIL released
+                pybind11::gil_scoped_acquire acquire;
+                try {
+                    if (value) {
+                        on_done(pybind11::cast(std::move(*value)), pybind11::none());
+                    } else {
+                        on_done(pybind11::none(), pybind11::reinterpret_borrow<pybind11::object>(error_type)(error));
+                    }
+                } catch (pybind11::error_already_set& e) {
+                    e.discard_as_unraisable("fast_solver background solve callback");
+                } catch (const std::exception& e) {
+                    // Converting the value or building the error failed (cast_error
+                    // and the like); nothing may leave this thread
+                    PyErr_SetString(PyExc_RuntimeError, e.what());
+                    PyErr_WriteUnraisable(on_done.ptr());
+                }
+                on_done = pybind11::function();  // dropped while the GIL is held
+            } else {
+                on_done.release();  // the interpreter is going away; leak rather than touch it
+            }
+            job->finished_ = true;
+        });
+        jobs.jobs.emplace_back(job, std::move(thread));
+        return job;
+    }
+    
+    // atexit hook: stop every running job and wait for its thread
+    static void shutdown() {
+        std::vector<std::pair<std::shared_ptr<BackgroundSolve>, std::thread>> running;
+        {
+            Registry& jobs = registry();
+            std::lock_guard<std::mutex> lock(jobs.mutex);
+            jobs.shutting_down = true;
+            running.swap(jobs.jobs);
+        }
+        for (auto& entry : running) entry.first->stop();
+        pybind11::gil_scoped_release release;
+        for (auto& entry : running) entry.second.join();
     }
 };
 
 PYBIND11_MODULE(fast_solver, m) {
+    m.def("simd_backend", []() { return std::string(bitboard_kernels().name); }, 
+          "Bitboard kernels selected for this CPU");
+    
+    m.def("configure_cache", [](int capacity, const std::string& directory) {
+        SolutionCache& cache = solution_cache();
+        cache.solved.set_capacity(static_cast<size_t>(std::max(capacity, 0)));
+        cache.warm.set_capacity(static_cast<size_t>(std::max(capacity, 0)));
+        std::lock_guard<std::mutex> lock(cache.directory_mutex);
+        cache.directory = directory;
+    }, pybind11::arg("capacity") = 64, pybind11::arg("directory") = "",
+       "Entries kept in memory and the directory solved instances are written to, empty for none");
+    m.def("clear_cache", []() {
+        solution_cache().solved.clear();
+        solution_cache().warm.clear();
+    }, "Drop the in-memory solution cache; files in the cache directory stay");
+    m.def("configure_task_pool", [](int threads) {
+        task_pool().resize(threads > 0 ? threads : static_cast<int>(std::thread::hardware_concurrency()));
+    }, pybind11::arg("threads") = 0, 
+       "Worker threads shared by greedy starts, component solves and CP-SAT search, 0 for one per hardware thread");
+    m.def("task_pool_stats", []() {
+        TaskPoolStats stats = task_pool().stats();
+        return std::map<std::string, long long>{
+            {"threads", stats.threads},
+            {"queued", stats.queued},
+            {"max_queued", stats.max_queued},
+            {"submitted", stats.submitted},
+            {"executed", stats.executed},
+            {"steals", stats.steals},
+            {"active_solvers", stats.active_solvers},
+        };
+    });
+    m.def("cache_stats", []() {
+        SolutionCache& cache = solution_cache();
+        return std::map<std::string, long long>{
+            {"entries", static_cast<long long>(cache.solved.size())},
+            {"warm_entries", static_cast<long long>(cache.warm.size())},
+            {"hits", cache.hits.load()},
+            {"misses", cache.misses.load()},
+        };
+    });
+    
+    pybind11::class_<AssignRequestData>(m, "ParsedRequest")
+        .def_property_readonly("num_students", [](const AssignRequestData& r) { return r.students.size(); })
+        .def_property_readonly("num_rooms", [](const AssignRequestData& r) { return r.rooms.size(); })
+        .def_property_readonly("file_numbers", [](const AssignRequestData& r) { return r.students.file_number; })
+        .def("records", [](const AssignRequestData& r) {
+            // Student fields as dicts, for callers that still build the response in Python
+            const RequestStudents& s = r.students;
+            pybind11::list records;
+            for (size_t i = 0; i < s.size(); i++) {
+                pybind11::dict record;
+                record["file_number"] = s.file_number[i];
+                record["name"] = s.name[i];
+                record["major"] = s.major[i];
+                record["examination_date"] = s.examination_date[i];
+                record["course_code"] = s.course_code[i];
+                record["course_name"] = s.course_name[i];
+                record["language"] = s.language[i];
+                record["academic_year"] = s.academic_year[i];
+                record["time"] = s.time[i];
+                records.append(record);
+            }
+            return records;
+        });
+    
+    m.def("parse_assign_request", [](pybind11::bytes body) {
+        char* data = nullptr;
+        Py_ssize_t size = 0;
+        if (PyBytes_AsStringAndSize(body.ptr(), &data, &size) != 0) throw pybind11::error_already_set();
+        pybind11::gil_scoped_release release;
+        return parse_assign_request(std::string_view(data, static_cast<size_t>(size)));
+    }, pybind11::arg("body"),
+       "Parse and validate an /assign request body; raises ValueError naming the bad field");
+    m.def("assign_response_json", [](const AssignRequestData& request, const SolveResult& result) {
+        std::string body;
+        {
+            pybind11::gil_scoped_release release;
+            body = assign_response_json(request.students, result.assignments);
+        }
+        return pybind11::bytes(body);
+    }, pybind11::arg("request"), pybind11::arg("result"),
+       "AssignResponse JSON body for a solve of a parsed request");
+    
+    m.attr("ASSIGNMENT_COLUMNS") = std::string(kAssignmentColumns);
+    m.def("assignment_table", [](const AssignRequestData& request, const SolveResult& result, 
+                                 const std::string& date, const std::string& format) {
+        std::string table;
+        {
+            pybind11::gil_scoped_release release;
+            const RequestStudents& students = request.students;
+            std::unordered_map<int32_t, uint32_t> row_of;
+            row_of.reserve(students.size());
+            for (size_t i = 0; i < students.size(); i++) row_of.emplace(students.file_number[i], static_cast<uint32_t>(i));
+            auto field_of = [&](const TextColumn& column) {
+                return [&](int student_id) {
+                    auto found = row_of.find(student_id);
+                    return found == row_of.end() ? std::string_view() : column[found->second];
+                };
+            };
+            auto date_of = [&](int student_id) {
+                return date.empty() ? field_of(students.examination_date)(student_id) : std::string_view(date);
+            };
+            table = assignment_table(result.assignments, field_of(students.course_code), date_of, table_format(format));
+        }
+        return pybind11::bytes(table);
+    }, pybind11::arg("request"), pybind11::arg("result"), pybind11::arg("date") = "", pybind11::arg("format") = "copy",
+       "Assignments of a solve as a bulk-load payload (columns ASSIGNMENT_COLUMNS), format \"copy\" or \"csv\". "
+       "An empty date uses each student's examination_date.");
+    m.def("assignment_table", [](const std::vector<Student>& students, const SolveResult& result, 
+                                 const std::string& date, const std::string& format) {
+        std::string table;
+        {
+            pybind11::gil_scoped_release release;
+            std::unordered_map<int, std::string_view> exam_of;
+            exam_of.reserve(students.size());
+            for (const auto& student : students) exam_of.emplace(student.id, student.exam);
+            table = assignment_table(result.assignments, [&](int student_id) {
+                auto found = exam_of.find(student_id);
+                return found == exam_of.end() ? std::string_view() : found->second;
+            }, [&](int) { return std::string_view(date); }, table_format(format));
+        }
+        return pybind11::bytes(table);
+    }, pybind11::arg("students"), pybind11::arg("result"), pybind11::arg("date"), pybind11::arg("format") = "copy");
+    
     pybind11::class_<Student>(m, "Student")
         .def(pybind11::init<int, std::string>())
         .def_readwrite("id", &Student::id)
         .def_readwrite("exam", &Student::exam);
     
     pybind11::class_<Room>(m, "Room")
-        .def(pybind11::init<std::string, int, int, bool, bool>())
+        .def(pybind11::init<std::string, int, int, bool, int>())
+        .def(pybind11::init<std::string, std::vector<std::pair<int, int>>, std::vector<std::pair<int, int>>>(),
+             pybind11::arg("id"), pybind11::arg("seats"), pybind11::arg("adjacency") = std::vector<std::pair<int, int>>())
+        .def_static("from_mask", &Room::from_mask, 
+                    pybind11::arg("id"), pybind11::arg("mask"), pybind11::arg("adjacency") = std::vector<std::pair<int, int>>())
         .def_readwrite("id", &Room::id)
         .def_readwrite("rows", &Room::rows)
         .def_readwrite("cols", &Room::cols)
         .def_readwrite("skip_rows", &Room::skip_rows)
-        .def_readwrite("skip_cols", &Room::skip_cols);
+        .def_readwrite("skip_cols", &Room::skip_cols)
+        .def_readonly("seats", &Room::seats)
+        .def_readonly("adjacency", &Room::adjacency);
     
     pybind11::class_<Assignment>(m, "Assignment")
         .def_readwrite("student_id", &Assignment::student_id)
@@ -300,7 +2765,124 @@ PYBIND11_MODULE(fast_solver, m) {
         .def_readwrite("row", &Assignment::row)
         .def_readwrite("col", &Assignment::col);
     
+    pybind11::class_<RoomPlanEntry>(m, "RoomPlanEntry")
+        .def_readwrite("exam", &RoomPlanEntry::exam)
+        .def_readwrite("room_id", &RoomPlanEntry::room_id)
+        .def_readwrite("count", &RoomPlanEntry::count);
+    
+    pybind11::class_<RoomPlan>(m, "RoomPlan")
+        .def_readwrite("entries", &RoomPlan::entries)
+        .def_readwrite("assignments", &RoomPlan::assignments)
+        .def_readwrite("rooms_used", &RoomPlan::rooms_used)
+        .def_readwrite("lower_bound", &RoomPlan::lower_bound)
+        .def_readwrite("complete", &RoomPlan::complete)
+        .def_readwrite("method", &RoomPlan::method);
+    
+    pybind11::class_<Separation>(m, "Separation")
+        .def(pybind11::init<>())
+        .def(pybind11::init<std::string, int>(), pybind11::arg("kind"), pybind11::arg("radius") = 1)
+        .def(pybind11::init<std::vector<std::pair<int, int>>>(), pybind11::arg("offsets"))
+        .def_readwrite("kind", &Separation::kind)
+        .def_readwrite("radius", &Separation::radius)
+        .def_readwrite("offsets", &Separation::offsets);
+    
+    pybind11::class_<Pin>(m, "Pin")
+        .def(pybind11::init<int, std::string, int, int>(),
+             pybind11::arg("student_id"), pybind11::arg("room_id"), pybind11::arg("row") = -1, pybind11::arg("col") = -1)
+        .def_readwrite("student_id", &Pin::student_id)
+        .def_readwrite("room_id", &Pin::room_id)
+        .def_readwrite("row", &Pin::row)
+        .def_readwrite("col", &Pin::col);
+    
+    pybind11::class_<SolveOptions>(m, "SolveOptions")
+        .def(pybind11::init<>())
+        .def_readwrite("mode", &SolveOptions::mode)
+        .def_readwrite("timeout_seconds", &SolveOptions::timeout_seconds)
+        .def_readwrite("accept_gap", &SolveOptions::accept_gap)
+        .def_readwrite("on_progress", &SolveOptions::on_progress)
+        .def_readwrite("formulation", &SolveOptions::formulation)
+        .def_readwrite("memory_limit_mb", &SolveOptions::memory_limit_mb)
+        .def_readwrite("greedy_starts", &SolveOptions::greedy_starts)
+        .def_readwrite("seed", &SolveOptions::seed)
+        .def_readwrite("num_threads", &SolveOptions::num_threads)
+        .def_readwrite("separation", &SolveOptions::separation)
+        .def_readwrite("spread_weight", &SolveOptions::spread_weight)
+        .def_readwrite("balance_weight", &SolveOptions::balance_weight)
+        .def_readwrite("separation_mode", &SolveOptions::separation_mode)
+        .def_readwrite("use_cache", &SolveOptions::use_cache)
+        .def_readwrite("decompose", &SolveOptions::decompose)
+        .def_readwrite("pins", &SolveOptions::pins);
+    
+    pybind11::class_<ProgressUpdate>(m, "ProgressUpdate")
+        .def_readonly("sequence", &ProgressUpdate::sequence)
+        .def_readonly("elapsed_ms", &ProgressUpdate::elapsed_ms)
+        .def_readonly("rooms_used", &ProgressUpdate::rooms_used)
+        .def_readonly("lower_bound", &ProgressUpdate::lower_bound)
+        .def_readonly("engine", &ProgressUpdate::engine)
+        .def_readonly("room_of", &ProgressUpdate::room_of)
+        .def_readonly("row_of", &ProgressUpdate::row_of)
+        .def_readonly("col_of", &ProgressUpdate::col_of);
+    
+    pybind11::class_<SolveResult>(m, "SolveResult")
+        .def_readwrite("assignments", &SolveResult::assignments)
+        .def_readwrite("engine", &SolveResult::engine)
+        .def_readwrite("status", &SolveResult::status)
+        .def_readwrite("rooms_used", &SolveResult::rooms_used)
+        .def_readwrite("lower_bound", &SolveResult::lower_bound)
+        .def_readwrite("gap", &SolveResult::gap)
+        .def_readwrite("valid", &SolveResult::valid)
+        .def_readwrite("solve_ms", &SolveResult::solve_ms)
+        .def_readwrite("formulation", &SolveResult::formulation)
+        .def_readwrite("model_variables", &SolveResult::model_variables)
+        .def_readwrite("peak_rss_mb", &SolveResult::peak_rss_mb)
+        .def_readwrite("seed", &SolveResult::seed)
+        .def_readwrite("exam_rooms", &SolveResult::exam_rooms)
+        .def_readwrite("max_fill_percent", &SolveResult::max_fill_percent)
+        .def_readwrite("cached", &SolveResult::cached)
+        .def_readwrite("instance_key", &SolveResult::instance_key);
+    
     pybind11::class_<FastSeatingOptimizer>(m, "FastSeatingOptimizer")
         .def(pybind11::init<>())
-        .def("solve", &FastSeatingOptimizer::solve);
-}
\ No newline at end of file
+        .def("solve", &FastSeatingOptimizer::solve, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("run", &FastSeatingOptimizer::run, pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("run_request", &FastSeatingOptimizer::run_request, 
+             pybind11::arg("request"), pybind11::arg("options") = SolveOptions(), 
+             pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("plan_rooms", &FastSeatingOptimizer::plan_rooms, 
+             pybind11::arg("students"), pybind11::arg("rooms"), pybind11::arg("restrictions"), 
+             pybind11::arg("separation") = Separation(), pybind11::call_guard<pybind11::gil_scoped_release>())
+        .def("progress", &FastSeatingOptimizer::progress)
+        .def("progress_sequence", &FastSeatingOptimizer::progress_sequence)
+        .def("stop", &FastSeatingOptimizer::stop);
+    
+    pybind11::module_::import("atexit").attr("register")(pybind11::cpp_function(&BackgroundSolve::shutdown));
+    pybind11::class_<BackgroundSolve, std::shared_ptr<BackgroundSolve>>(m, "BackgroundSolve")
+        .def_property_readonly("done", &BackgroundSolve::done)
+        .def("progress", &BackgroundSolve::progress)
+        .def("progress_sequence", &BackgroundSolve::progress_sequence)
+        .def("stop", &BackgroundSolve::stop);
+    
+    m.def("solve_async", [](std::vector<Student> students, std::vector<Room> rooms, 
+                            std::unordered_map<std::string, std::vector<std::string>> restrictions, 
+                            SolveOptions options, pybind11::function on_done) {
+        return BackgroundSolve::start(std::move(on_done), 
+            [students = std::move(students), rooms = std::move(rooms), restrictions = std::move(restrictions), 
+             options = std::move(options)](FastSeatingOptimizer& solver) {
+                return solver.run(students, rooms, restrictions, options);
+            });
+    }, pybind11::arg("students"), pybind11::arg("rooms"), pybind11::arg("restrictions"), 
+       pybind11::arg("options"), pybind11::arg("on_done"),
+       "FastSeatingOptimizer.run on a native thread; on_done(SolveResult, None) or on_done(None, exception)");
+    m.def("solve_request_async", [](pybind11::bytes body, SolveOptions options, pybind11::function on_done) {
+        std::string text(body);
+        return BackgroundSolve::start(std::move(on_done), 
+            [text = std::move(text), options = std::move(options)](FastSeatingOptimizer& solver) {
+                AssignRequestData request = parse_assign_request(text);
+                SolveResult result = solver.run_request(request, options);
+                return std::make_tuple(std::move(request), std::move(result));
+            });
+    }, pybind11::arg("body"), pybind11::arg("options"), pybind11::arg("on_done"),
+       "parse_assign_request and run_request on a native thread; on_done((ParsedRequest, SolveResult), None) "
+       "or on_done(None, exception)");
+}
+#endif
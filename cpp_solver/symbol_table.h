@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+
+// Dense integer IDs for the strings of one request (exam codes, room IDs).
+// IDs follow first appearance. The table stores views only: the strings
+// belong to the caller's Student / Room objects and restriction map, which
+// outlive the solve, so interning never copies a name.
+class SymbolTable {
+private:
+    std::pmr::unordered_map<std::string_view, int32_t> index_;
+    std::pmr::vector<std::string_view> names_;
+
+public:
+    explicit SymbolTable(std::pmr::memory_resource* arena) : index_(arena), names_(arena) {}
+
+    // ID of name, adding it if it is new
+    int32_t intern(std::string_view name) {
+        auto it = index_.emplace(name, static_cast<int32_t>(names_.size())).first;
+        if (it->second == static_cast<int32_t>(names_.size())) names_.push_back(name);
+        return it->second;
+    }
+
+    // ID of name, -1 if it was never interned
+    int32_t find(std::string_view name) const {
+        auto it = index_.find(name);
+        return it == index_.end() ? -1 : it->second;
+    }
+
+    std::string_view name(int32_t id) const { return names_[id]; }
+    int size() const { return static_cast<int>(names_.size()); }
+
+    void reserve(size_t count) {
+        index_.reserve(count);
+        names_.reserve(count);
+    }
+};
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The native module's one thread pool. Every worker owns a deque: it takes
+// its own newest task first and, when that is empty, steals the oldest task
+// of another worker, so a thread left idle by a small room or component
+// picks up work queued behind a large one. Tasks submitted from a worker go
+// to its own deque; tasks from other threads are dealt round robin.
+//
+// run() is the only entry point the solver uses: it runs copies of a worker
+// function, one on the calling thread, and while waiting for the rest the
+// caller runs queued tasks itself. A pool task may therefore call run()
+// again (a component solve running greedy starts) without deadlocking, even
+// when every worker is busy.
+//
+// CP-SAT starts its own search threads. Each solve takes a SolverThreads
+// lease sized from the pool and the CP-SAT solves already running when it
+// starts, so parallel component solves do not each start a full set of
+// search workers on top of the pool.
+
+struct TaskPoolStats {
+    int threads = 0;
+    long long queued = 0;       // tasks waiting in the deques now
+    long long max_queued = 0;   // high-water mark of queued
+    long long submitted = 0;
+    long long executed = 0;
+    long long steals = 0;       // tasks taken from another worker's deque
+    int active_solvers = 0;     // CP-SAT solves holding a lease
+};
+
+class TaskPool {
+private:
+    // Deques are never reallocated, so workers can be added while others
+    // are stealing; parked workers' leftovers stay stealable
+    static constexpr int kMaxThreads = 256;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::unique_ptr<Queue[]> queues_{new Queue[kMaxThreads]};
+    std::vector<std::thread> workers_;
+    std::mutex workers_mutex_;      // guards workers_ while resizing
+    std::atomic<int> spawned_{0};   // deques that may hold tasks
+    std::atomic<int> size_{0};      // workers taking tasks; the rest are parked
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+
+    std::atomic<unsigned> next_queue_{0};
+    std::atomic<long long> queued_{0};
+    std::atomic<long long> max_queued_{0};
+    std::atomic<long long> submitted_{0};
+    std::atomic<long long> executed_{0};
+    std::atomic<long long> steals_{0};
+    std::atomic<int> active_solvers_{0};
+
+    // Deque of the calling thread, -1 outside this pool's workers
+    int home() const {
+        return current_pool() == this ? current_index() : -1;
+    }
+
+    static const TaskPool*& current_pool() {
+        static thread_local const TaskPool* pool = nullptr;
+        return pool;
+    }
+
+    static int& current_index() {
+        static thread_local int index = -1;
+        return index;
+    }
+
+    bool take(int from, bool newest, std::function<void()>& task) {
+        Queue& queue = queues_[from];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        if (newest) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        queued_--;
+        return true;
+    }
+
+    void work(int index) {
+        current_pool() = this;
+        current_index() = index;
+        while (true) {
+            if (index < size_.load() && run_one()) continue;
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait(lock, [&] { return stopping_ || (index < size_.load() && queued_.load() > 0); });
+            if (stopping_) return;
+        }
+    }
+
+public:
+    explicit TaskPool(int threads) { resize(threads); }
+
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    int size() const { return size_.load(); }
+
+    // Workers beyond the new size finish their current task and park; their
+    // queued tasks are stolen by the others. Growing starts new threads.
+    void resize(int threads) {
+        threads = std::max(1, std::min(threads, kMaxThreads));
+        std::lock_guard<std::mutex> lock(workers_mutex_);
+        while (static_cast<int>(workers_.size()) < threads) {
+            int index = static_cast<int>(workers_.size());
+            spawned_.store(index + 1);
+            workers_.emplace_back([this, index] { work(index); });
+        }
+        {
+            std::lock_guard<std::mutex> wake_lock(wake_mutex_);
+            size_.store(threads);
+        }
+        wake_.notify_all();
+    }
+
+    void submit(std::function<void()> task) {
+        int to = home();
+        if (to < 0 || to >= size_.load()) to = static_cast<int>(next_queue_++ % static_cast<unsigned>(size_.load()));
+        {
+            std::lock_guard<std::mutex> lock(queues_[to].mutex);
+            queues_[to].tasks.push_back(std::move(task));
+        }
+        submitted_++;
+        long long depth = ++queued_;
+        long long high = max_queued_.load();
+        while (depth > high && !max_queued_.compare_exchange_weak(high, depth)) {}
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+        }
+        wake_.notify_one();
+    }
+
+    // One queued task on the calling thread: its own newest, else another
+    // deque's oldest. False if every deque was empty.
+    bool run_one() {
+        std::function<void()> task;
+        int own = home();
+        bool found = own >= 0 && take(own, true, task);
+        if (!found) {
+            int count = spawned_.load();
+            int first = static_cast<int>(next_queue_.load() % static_cast<unsigned>(count));
+            for (int k = 0; k < count && !found; k++) {
+                int from = (first + k) % count;
+                if (from != own) found = take(from, false, task);
+            }
+            if (!found) return false;
+            steals_++;
+        }
+        task();
+        executed_++;
+        return true;
+    }
+
+    // copies calls of worker, one on this thread and the rest as pool tasks,
+    // returning when all have. Workers share their work through their own
+    // atomics. The first exception thrown by any copy is rethrown here.
+    void run(int copies, const std::function<void()>& worker) {
+        if (copies <= 1) {
+            worker();
+            return;
+        }
+
+        struct Batch {
+            std::mutex mutex;
+            std::condition_variable done;
+            int running = 0;
+            std::exception_ptr error;
+        } batch;
+        batch.running = copies - 1;
+
+        auto guarded = [&batch, &worker]() {
+            try {
+                worker();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                if (!batch.error) batch.error = std::current_exception();
+            }
+        };
+        for (int c = 1; c < copies; c++) {
+            submit([&batch, guarded]() {
+                guarded();
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                if (--batch.running == 0) batch.done.notify_all();
+            });
+        }
+        guarded();
+
+        // Help while the other copies run; the short wait only matters when
+        // there is nothing left to help with
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(batch.mutex);
+                if (batch.running == 0) break;
+            }
+            if (run_one()) continue;
+            std::unique_lock<std::mutex> lock(batch.mutex);
+            batch.done.wait_for(lock, std::chrono::milliseconds(1), [&] { return batch.running == 0; });
+        }
+        if (batch.error) std::rethrow_exception(batch.error);
+    }
+
+    // Copies of a worker worth starting for `items` independent items when
+    // the caller asks for `requested` threads (0 for the whole pool)
+    int width(int requested, size_t items) const {
+        int threads = requested > 0 ? requested : size();
+        return static_cast<int>(std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(threads), items)));
+    }
+
+    TaskPoolStats stats() const {
+        TaskPoolStats stats;
+        stats.threads = size();
+        stats.queued = queued_.load();
+        stats.max_queued = max_queued_.load();
+        stats.submitted = submitted_.load();
+        stats.executed = executed_.load();
+        stats.steals = steals_.load();
+        stats.active_solvers = active_solvers_.load();
+        return stats;
+    }
+
+    // CP-SAT search threads for one solve: an even share of the pool among
+    // the solves holding a lease, at least one and at most `wanted`
+    class SolverThreads {
+    private:
+        TaskPool& pool_;
+        int threads_;
+
+    public:
+        SolverThreads(TaskPool& pool, int wanted) : pool_(pool) {
+            int solvers = ++pool_.active_solvers_;
+            threads_ = std::max(1, std::min(wanted, pool_.size() / solvers));
+        }
+        ~SolverThreads() { pool_.active_solvers_--; }
+
+        SolverThreads(const SolverThreads&) = delete;
+        SolverThreads& operator=(const SolverThreads&) = delete;
+
+        int threads() const { return threads_; }
+    };
+};
+
+// Sized from FAST_SOLVER_THREADS, else one worker per hardware thread;
+// configure_task_pool resizes it at run time
+inline TaskPool& task_pool() {
+    static TaskPool pool([] {
+        const char* env = std::getenv("FAST_SOLVER_THREADS");
+        int threads = env != nullptr ? std::atoi(env) : 0;
+        return threads > 0 ? threads : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }());
+    return pool;
+}
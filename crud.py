@@ -1,4 +1,7 @@
+from sqlalchemy import text
 from sqlalchemy.orm import Session
+import csv
+import io
 import models
 from typing import List, Optional
 from datetime import date
@@ -125,6 +128,75 @@ def create_assignment(db: Session, student_id: int, room_id: str, exam_name: str
     db.refresh(db_assignment)
     return db_assignment
 
+ASSIGNMENT_COLUMNS = "student_id, room_id, exam_name, row, col, date"
+
+def bulk_create_assignments(db: Session, table: bytes, table_format: str = "copy",
+                            columns: str = ASSIGNMENT_COLUMNS):
+    """
+    Load a whole assignments table in one statement and one commit. table is a
+    bulk-load payload from fast_solver.assignment_table ("copy" text or "csv").
+    PostgreSQL streams it through COPY ... FROM STDIN; other databases get one
+    executemany INSERT over the decoded rows, bound as typed values (the SQL
+    Server engine batches it with fast_executemany). Returns the number of rows.
+    """
+    if db.get_bind().dialect.name == "postgresql":
+        cursor = db.connection().connection.cursor()
+        options = " WITH (FORMAT csv)" if table_format == "csv" else ""
+        cursor.copy_expert(f"COPY assignments ({columns}) FROM STDIN{options}", io.BytesIO(table))
+        count = cursor.rowcount
+    else:
+        names = [name.strip() for name in columns.split(",")]
+        types = [_ASSIGNMENT_TYPES.get(name, str) for name in names]
+        rows = [{name: convert(value) for name, convert, value in zip(names, types, values)}
+                for values in _table_rows(table, table_format)]
+        if rows:
+            placeholders = ", ".join(f":{name}" for name in names)
+            db.execute(text(f"INSERT INTO assignments ({columns}) VALUES ({placeholders})"), rows)
+        count = len(rows)
+    db.commit()
+    return count
+
+def assignments_csv(rows):
+    """
+    CSV bulk-load payload for bulk_create_assignments from Python rows of
+    (student_id, room_id, exam_name, row, col, date), columns as in
+    ASSIGNMENT_COLUMNS. For seatings that did not come from the native solver.
+    """
+    out = io.StringIO(newline="")
+    csv.writer(out, lineterminator="\n").writerows(
+        (student_id, room_id, exam_name, row, col, day.isoformat())
+        for student_id, room_id, exam_name, row, col, day in rows)
+    return out.getvalue().encode("utf-8")
+
+# Column types of the bulk-load payload; the rest are strings
+_ASSIGNMENT_TYPES = {"student_id": int, "row": int, "col": int, "date": date.fromisoformat}
+
+def _table_rows(table: bytes, table_format: str):
+    """Rows of a COPY text or CSV payload as lists of strings"""
+    decoded = table.decode("utf-8")
+    if table_format == "csv":
+        return list(csv.reader(io.StringIO(decoded, newline="")))
+    escapes = {"\\\\": "\\", "\\t": "\t", "\\n": "\n", "\\r": "\r"}
+    rows = []
+    for line in decoded.split("\n")[:-1]:
+        fields = line.split("\t")
+        if "\\" in line:
+            fields = [_unescape_copy(field, escapes) for field in fields]
+        rows.append(fields)
+    return rows
+
+def _unescape_copy(field, escapes):
+    out, i = [], 0
+    while i < len(field):
+        pair = field[i:i + 2]
+        if pair in escapes:
+            out.append(escapes[pair])
+            i += 2
+        else:
+            out.append(field[i])
+            i += 1
+    return "".join(out)
+
 def get_assignments(db: Session, skip: int = 0, limit: int = 100):
     return db.query(models.Assignment).order_by(models.Assignment.id).offset(skip).limit(limit).all()
 
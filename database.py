@@ -12,6 +12,8 @@ engine = create_engine(
     pool_recycle=300,
     pool_timeout=30,
     max_overflow=10,
+    # executemany sends all rows in one batch instead of one round trip per row
+    fast_executemany=True,
     connect_args={
         "timeout": 60,
         "autocommit": False
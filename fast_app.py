@@ -1,4 +1,6 @@
-from fast_solver import FastSeatingOptimizer, Student, Room
+import asyncio
+from fast_solver import FastSeatingOptimizer, Student, Room, SolveOptions, Separation, Pin, parse_assign_request, assign_response_json
+from fast_solver import assignment_table, ASSIGNMENT_COLUMNS, solve_async, solve_request_async
 
 def assign_students_to_rooms_fast(students, rooms, exam_room_restrictions=None, timeout_seconds=120):
     """Fast C++ implementation wrapper"""
@@ -18,4 +20,231 @@ def assign_students_to_rooms_fast(students, rooms, exam_room_restrictions=None,
     for assignment in assignments:
         result[assignment.student_id] = (assignment.room_id, assignment.row, assignment.col)
     
-    return result
\ No newline at end of file
+    return result
+
+def assign_students_native(students, rooms, exam_room_restrictions=None, timeout_seconds=120, mode="auto",
+                           on_progress=None, accept_gap=0, memory_limit_mb=0, room_layouts=None,
+                           separation=None, greedy_starts=1, seed=0, spread_weight=0, balance_weight=0,
+                           use_cache=True, separation_mode="eager", pins=None):
+    """
+    Native solver for the full student schema.
+    students: StudentExamRequest objects or dicts; room tuples as in the other solvers.
+    Returns (list of AssignmentWithStudentOut, SolveResult) - the result carries
+    rooms_used, lower_bound and gap so callers can tell a proven optimum apart.
+    timeout_seconds bounds the whole call, model building included: a model
+    that cannot be built within its share leaves the packing or greedy seating
+    as the answer, so a result arrives by the deadline.
+    on_progress(update) is called from the solver thread with every improving
+    solution; the search stops early once its gap is at most accept_gap.
+    memory_limit_mb caps the CP-SAT model; over the cap the solver falls back
+    to a smaller formulation or the packing plan instead of running out of memory.
+    room_layouts maps a room ID to (seat_mask, adjacency) for rooms that are not
+    plain grids; those rooms ignore rows, cols and the skip flags.
+    separation is the neighbour rule (kind / radius / offsets, as in
+    room_layout.separation_offsets), None for left/right/front/back.
+    greedy_starts > 1 runs that many randomised greedy restarts in parallel
+    from seed; the winning seed is reported in the result, and passing it back
+    with one start reproduces the seating. Restarts, independent components
+    and CP-SAT's search workers share one thread pool; see
+    fast_solver.configure_task_pool and fast_solver.task_pool_stats.
+    spread_weight and balance_weight rank seatings with the fewest rooms: the
+    first per room an exam is split over, the second per percentage point of
+    the fullest room's fill. The result reports exam_rooms and max_fill_percent.
+    separation_mode="lazy" leaves the neighbour constraints out of the CP-SAT
+    model and adds only those a solution breaks, re-solving until none are.
+    use_cache answers a resubmitted instance (same students, rooms, restrictions
+    and options, in any order) from the process-wide solution cache; see
+    fast_solver.configure_cache for its size and on-disk directory.
+    pins hold students to a seat (room_id, row, col) or a room (room_id only),
+    as dicts, objects or (student_id, room_id[, row, col]) tuples. Several pins
+    of one student let the solver pick among them; pins override restrictions.
+    """
+    cpp_students, cpp_rooms, restrictions, options = _native_inputs(
+        students, rooms, exam_room_restrictions, timeout_seconds, mode, on_progress, accept_gap, memory_limit_mb,
+        room_layouts, separation, greedy_starts, seed, spread_weight, balance_weight, use_cache, separation_mode, pins)
+    optimizer = FastSeatingOptimizer()
+    solve_result = optimizer.run(cpp_students, cpp_rooms, restrictions, options)
+    return _native_assignments(students, solve_result)
+
+async def assign_students_native_async(students, rooms, exam_room_restrictions=None, timeout_seconds=120, mode="auto",
+                                       on_progress=None, accept_gap=0, memory_limit_mb=0, room_layouts=None,
+                                       separation=None, greedy_starts=1, seed=0, spread_weight=0, balance_weight=0,
+                                       use_cache=True, separation_mode="eager", pins=None):
+    """
+    assign_students_native as a coroutine, same arguments and result. The solve
+    runs on a native thread and completes a future on the running loop, so
+    awaiting it holds neither the loop nor a threadpool worker. Cancelling the
+    awaiting task stops the search.
+    """
+    cpp_students, cpp_rooms, restrictions, options = _native_inputs(
+        students, rooms, exam_room_restrictions, timeout_seconds, mode, on_progress, accept_gap, memory_limit_mb,
+        room_layouts, separation, greedy_starts, seed, spread_weight, balance_weight, use_cache, separation_mode, pins)
+    solve_result = await _await_native(
+        lambda on_done: solve_async(cpp_students, cpp_rooms, restrictions, options, on_done))
+    return _native_assignments(students, solve_result)
+
+async def _await_native(start):
+    """Start a native background solve with start(on_done) and await its value"""
+    loop = asyncio.get_running_loop()
+    future = loop.create_future()
+
+    def settle(value, error):
+        if future.done():  # cancelled while the solver finished
+            return
+        if error is not None:
+            future.set_exception(error)
+        else:
+            future.set_result(value)
+
+    job = start(lambda value, error: loop.call_soon_threadsafe(settle, value, error))
+    try:
+        return await future
+    except asyncio.CancelledError:
+        job.stop()
+        raise
+
+def _native_inputs(students, rooms, exam_room_restrictions, timeout_seconds, mode, on_progress, accept_gap,
+                   memory_limit_mb, room_layouts, separation, greedy_starts, seed, spread_weight, balance_weight,
+                   use_cache, separation_mode, pins):
+    """Native students, rooms, restrictions and SolveOptions for assign_students_native"""
+    if exam_room_restrictions is None:
+        exam_room_restrictions = {}
+
+    cpp_students = []
+    for s in students:
+        file_number = s.file_number if hasattr(s, "file_number") else s["file_number"]
+        course_code = s.course_code if hasattr(s, "course_code") else s["course_code"]
+        cpp_students.append(Student(file_number, course_code))
+    if room_layouts is None:
+        room_layouts = {}
+
+    cpp_rooms = []
+    for rid, R, C, skip_rows, skip_cols in rooms:
+        if rid in room_layouts:
+            seat_mask, adjacency = room_layouts[rid]
+            cpp_rooms.append(Room.from_mask(rid, seat_mask, [tuple(pair) for pair in adjacency or []]))
+        else:
+            cpp_rooms.append(Room(rid, R, C, bool(skip_rows), int(skip_cols)))
+
+    options = SolveOptions()
+    options.mode = mode
+    options.timeout_seconds = timeout_seconds
+    options.accept_gap = accept_gap
+    options.memory_limit_mb = memory_limit_mb
+    options.greedy_starts = greedy_starts
+    options.seed = seed
+    options.spread_weight = spread_weight
+    options.balance_weight = balance_weight
+    options.use_cache = use_cache
+    options.separation_mode = separation_mode
+    if pins:
+        options.pins = [to_native_pin(pin) for pin in pins]
+    if separation is not None:
+        options.separation = to_native_separation(separation)
+    if on_progress is not None:
+        options.on_progress = on_progress
+    return cpp_students, cpp_rooms, exam_room_restrictions, options
+
+def _native_assignments(students, solve_result):
+    """(list of AssignmentWithStudentOut or None, solve_result), as assign_students_native returns"""
+    from simple_greedy_solver import build_assignment_with_student
+    from models import AssignmentWithStudentOut
+
+    print(f"Native solver: {solve_result.status} via {solve_result.engine}"
+          f"{' (cached)' if solve_result.cached else ''}, "
+          f"{solve_result.rooms_used} rooms (lower bound {solve_result.lower_bound}, gap {solve_result.gap}), "
+          f"{solve_result.exam_rooms} exam-room pairs, fullest room {solve_result.max_fill_percent}%, "
+          f"peak RSS {solve_result.peak_rss_mb:.0f} MB, seed {solve_result.seed}")
+
+    if not solve_result.valid:
+        return None, solve_result
+
+    assignment = {a.student_id: (a.room_id, a.row, a.col) for a in solve_result.assignments}
+    assignment_with_student = build_assignment_with_student(assignment, students)
+    return [AssignmentWithStudentOut(**a) for a in assignment_with_student], solve_result
+
+def assign_request_native(body, timeout_seconds=60, mode="auto", on_progress=None, accept_gap=0):
+    """
+    Native solver straight from an /assign request body (bytes or str), with
+    no Pydantic models in between. The body is parsed and validated in C++;
+    a malformed one raises ValueError naming the offending field.
+    Returns (ParsedRequest, SolveResult); the parsed request keeps the student
+    fields needed to build the response, see assign_response_body.
+    """
+    if isinstance(body, str):
+        body = body.encode("utf-8")
+    request = parse_assign_request(body)
+
+    optimizer = FastSeatingOptimizer()
+    solve_result = optimizer.run_request(request, _request_options(timeout_seconds, mode, on_progress, accept_gap))
+    _report_request(request, solve_result)
+    return request, solve_result
+
+async def assign_request_native_async(body, timeout_seconds=60, mode="auto", on_progress=None, accept_gap=0):
+    """
+    assign_request_native as a coroutine: the body is parsed and solved on a
+    native thread, and the awaiting task resumes once the solve is done.
+    A malformed body raises ValueError from the await.
+    """
+    if isinstance(body, str):
+        body = body.encode("utf-8")
+    options = _request_options(timeout_seconds, mode, on_progress, accept_gap)
+    request, solve_result = await _await_native(lambda on_done: solve_request_async(body, options, on_done))
+    _report_request(request, solve_result)
+    return request, solve_result
+
+def _request_options(timeout_seconds, mode, on_progress, accept_gap):
+    options = SolveOptions()
+    options.mode = mode
+    options.timeout_seconds = timeout_seconds
+    options.accept_gap = accept_gap
+    if on_progress is not None:
+        options.on_progress = on_progress
+    return options
+
+def _report_request(request, solve_result):
+    print(f"Native solver (raw request): {solve_result.status} via {solve_result.engine}"
+          f"{' (cached)' if solve_result.cached else ''}, "
+          f"{request.num_students} students, {solve_result.rooms_used} rooms "
+          f"(lower bound {solve_result.lower_bound}, gap {solve_result.gap})")
+
+def assign_response_body(request, solve_result):
+    """AssignResponse JSON (bytes) for a solve from assign_request_native, written natively"""
+    return assign_response_json(request, solve_result)
+
+def assignment_table_native(request, solve_result, assignment_date=None, table_format="copy"):
+    """
+    Assignments table for crud.bulk_create_assignments as one payload (bytes),
+    columns ASSIGNMENT_COLUMNS. request is a ParsedRequest or the list of native
+    Students; dated by each student's examination_date unless assignment_date is
+    given (required with Students).
+    """
+    day = assignment_date.isoformat() if hasattr(assignment_date, "isoformat") else (assignment_date or "")
+    return assignment_table(request, solve_result, day, table_format)
+
+def to_native_separation(separation):
+    """Separation from a dict or SeparationPolicy"""
+    if isinstance(separation, Separation):
+        return separation
+    field = separation.get if isinstance(separation, dict) else (lambda name, default: getattr(separation, name, default))
+    native = Separation()
+    native.kind = field("kind", "von_neumann") or "von_neumann"
+    native.radius = 1 if field("radius", 1) is None else int(field("radius", 1))
+    native.offsets = [tuple(offset) for offset in field("offsets", None) or []]
+    return native
+
+def to_native_pin(pin):
+    """Pin from a dict, SeatPin or (student_id, room_id[, row, col]) tuple"""
+    if isinstance(pin, Pin):
+        return pin
+    if isinstance(pin, (tuple, list)):
+        student_id, room_id, *seat = pin
+        row, col = seat if seat else (-1, -1)
+        return Pin(int(student_id), room_id, int(row), int(col))
+    field = pin.get if isinstance(pin, dict) else (lambda name, default: getattr(pin, name, default))
+    student_id = field("student_id", None)
+    if student_id is None:
+        student_id = field("file_number", None)
+    row, col = field("row", None), field("col", None)
+    return Pin(int(student_id), field("room_id", None),
+               -1 if row is None else int(row), -1 if col is None else int(col))
@@ -35,19 +35,18 @@ class Room(Base):
     skip_cols = Column(Integer, default=0)  # <-- changed from Boolean to Integer
     # assignments = relationship("Assignment", back_populates="room")
 
-# class Assignment(Base):
-#     __tablename__ = "assignments"
+# Target of crud.bulk_create_assignments; student_id is the file number,
+# students arrive with the request and have no table of their own
+class Assignment(Base):
+    __tablename__ = "assignments"
 
-#     id = Column(Integer, primary_key=True, index=True)
-#     student_id = Column(Integer, ForeignKey("students.id"))
-#     room_id = Column(String(50), ForeignKey("rooms.room_id"))
-#     exam_name = Column(String(100))
-#     row = Column(Integer)
-#     col = Column(Integer)
-#     date = Column(Date, default=date.today)
-    
-#     student = relationship("Student", back_populates="assignments")
-#     room = relationship("Room", back_populates="assignments")
+    id = Column(Integer, primary_key=True, index=True)
+    student_id = Column(Integer, index=True)
+    room_id = Column(String(50), index=True)
+    exam_name = Column(String(100))
+    row = Column(Integer)
+    col = Column(Integer)
+    date = Column(Date, default=date.today)
 
 # Pydantic Models (for API request/response)
 # User models for authentication
@@ -98,7 +97,7 @@ class RoomIn(BaseModel):
     rows: int
     cols: int
     skip_rows: bool
-    skip_cols: int  # <-- changed to int
+    skip_cols: int  # 0 none, k skips every k-th column (c % k == k - 1); 1 means 2, the odd columns
 
 class AssignmentIn(BaseModel):
     student_id: int
@@ -136,12 +135,27 @@ class RoomRequest(BaseModel):
     rows: int
     cols: int
     skip_rows: bool
-    skip_cols: int  # <-- changed to int
+    skip_cols: int  # 0 none, k skips every k-th column (c % k == k - 1); 1 means 2, the odd columns
+    seat_mask: Optional[List[str]] = None  # one string per row, '.' or ' ' marks a missing seat
+    adjacency: Optional[List[List[int]]] = None  # extra neighbour pairs of row-major seat indices
+
+class SeparationPolicy(BaseModel):
+    kind: str = "von_neumann"  # "von_neumann", "moore" or "custom"
+    radius: int = 1
+    offsets: Optional[List[List[int]]] = None  # (dr, dc) pairs for "custom"
+
+class SeatPin(BaseModel):
+    file_number: int
+    room_id: str
+    row: Optional[int] = None  # row and col both unset: any seat of the room
+    col: Optional[int] = None
 
 class AssignRequest(BaseModel):
     students: List[StudentExamRequest]
     rooms: List[RoomRequest]
     exam_room_restrictions: Optional[Dict[str, List[str]]] = None
+    separation: Optional[SeparationPolicy] = None  # default: left/right/front/back
+    pins: Optional[List[SeatPin]] = None  # several pins of one student: any of them
 
 class AssignResponse(BaseModel):
     assignments: List[AssignmentOut]
@@ -2,6 +2,7 @@ import numpy as np
 from numba import jit, prange
 from ortools.sat.python import cp_model
 import time
+from room_layout import column_skipped
 
 def compute_room_positions_numba(rooms_data):
     """Fast room position computation using Numba"""
@@ -13,11 +14,13 @@ def compute_room_positions_numba(rooms_data):
         rows, cols, skip_rows, skip_cols = rooms_data[i]
         positions = []
         
+        stride = max(skip_cols, 2)
         for r in range(rows):
             if skip_rows == 1 and r % 2 != 0:
                 continue
             for c in range(cols):
-                if skip_cols == 1 and c % 2 != 0:
+                # Same rule as room_layout.column_skipped
+                if skip_cols >= 1 and c % stride == stride - 1:
                     continue
                 positions.append((r, c))
         
@@ -203,7 +206,7 @@ def visualize_assignment(assignment, rooms, students):
             # Mark skipped positions
             for r in range(rows):
                 for c in range(cols):
-                    if (skip_rows and r % 2 != 0) or (skip_cols and c % 2 != 0):
+                    if (skip_rows and r % 2 != 0) or column_skipped(c, skip_cols):
                         grid[r][c] = 'X'  # Skipped
             
             # Place students
@@ -0,0 +1,97 @@
+"""
+Seat layout of a room, shared by the Python solvers and the native solver
+so that every engine sees the same seats for the same room.
+
+skip_cols is an integer: 0 keeps every column, k >= 1 skips the last column
+of every k, the columns with c % k == k - 1, except that 1 (or True) means 2:
+both skip the odd columns. skip_rows skips odd rows.
+"""
+
+
+def column_skipped(c, skip_cols):
+    skip_cols = int(skip_cols or 0)
+    if skip_cols <= 0:
+        return False
+    stride = max(skip_cols, 2)
+    return c % stride == stride - 1
+
+
+def room_positions(rows, cols, skip_rows, skip_cols):
+    """Seats of a grid room in row-major order"""
+    positions = []
+    for r in range(rows):
+        if skip_rows and r % 2 != 0:
+            continue
+        for c in range(cols):
+            if column_skipped(c, skip_cols):
+                continue
+            positions.append((r, c))
+    return positions
+
+
+def mask_positions(seat_mask):
+    """Seats of a room given as one string per row; '.' or ' ' is no seat"""
+    return [(r, c) for r, line in enumerate(seat_mask) for c, ch in enumerate(line) if ch not in ". "]
+
+
+def separation_offsets(separation=None):
+    """
+    Neighbour offsets (dr, dc) of a separation policy, mirrored so the
+    relation is symmetric. separation is None for the classic 4-neighbour
+    rule, or anything with kind / radius / offsets fields (a dict, a
+    SeparationPolicy or the native Separation):
+      "von_neumann": |dr| + |dc| <= radius
+      "moore":       max(|dr|, |dc|) <= radius
+      "custom":      the listed offsets
+    """
+    if separation is None:
+        return [(-1, 0), (1, 0), (0, -1), (0, 1)]
+    if isinstance(separation, dict):
+        field = separation.get
+    else:
+        field = lambda name, default: getattr(separation, name, default)
+    kind = field("kind", "von_neumann") or "von_neumann"
+    radius = field("radius", 1)
+    radius = 1 if radius is None else int(radius)
+
+    if kind == "custom":
+        stencil = [(int(dr), int(dc)) for dr, dc in field("offsets", None) or []]
+    elif kind in ("von_neumann", "moore"):
+        if radius < 0:
+            raise ValueError("Separation radius must be non-negative")
+        stencil = [(dr, dc) for dr in range(-radius, radius + 1) for dc in range(-radius, radius + 1)
+                   if kind == "moore" or abs(dr) + abs(dc) <= radius]
+    else:
+        raise ValueError(f"Unknown separation kind: {kind}")
+
+    offsets = set()
+    for dr, dc in stencil:
+        if dr or dc:
+            offsets.add((dr, dc))
+            offsets.add((-dr, -dc))
+    return sorted(offsets)
+
+
+def stencil_shifts(rows, cols, offsets):
+    """
+    Bitboard form of a stencil over a row-major rows x cols grid (bit
+    r * cols + c). Each offset becomes (shift, guard): the seats blocked by
+    a mask m are the OR of shift(m) & guard, where guard drops the bits
+    that would wrap into the neighbouring row.
+    """
+    every_row = 0
+    for r in range(rows):
+        every_row |= 1 << (r * cols)
+    shifts = []
+    for dr, dc in offsets:
+        if abs(dc) >= cols:
+            continue
+        columns = 0
+        for c in range(max(dc, 0), cols + min(dc, 0)):
+            columns |= 1 << c
+        shifts.append((dr * cols + dc, columns * every_row))
+    return shifts
+
+
+def shift_mask(mask, shift):
+    return mask << shift if shift >= 0 else mask >> -shift
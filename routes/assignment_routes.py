@@ -1,4 +1,4 @@
-from fastapi import APIRouter, Depends, HTTPException
+from fastapi import APIRouter, Depends, HTTPException, Request, Response
 from sqlalchemy.orm import Session
 from typing import List
 from database import get_db
@@ -41,6 +41,33 @@ def assign(req: AssignRequest, db: Session = Depends(get_db)):
         traceback.print_exc()
         raise HTTPException(status_code=500, detail=f"Internal server error: {str(e)}")
 
+@router.post("/assign/fast", response_model=AssignResponse)
+async def assign_fast(request: Request, persist: bool = False, db: Session = Depends(get_db)):
+    """
+    Same as /assign; the request body goes to the native parser and the
+    response body comes back already serialised, without Pydantic on either side.
+    persist=true also stores the seating in one bulk load. The solve is
+    awaited rather than run on a threadpool worker, so concurrent requests
+    do not each hold a thread while they wait.
+    """
+    body = await request.body()
+    try:
+        response = await assignment_service.process_assignment_body_async(db, body, persist)
+    except ValueError as e:
+        raise HTTPException(status_code=422, detail=str(e))
+    except Exception as e:
+        print(f"Unexpected error in assign_fast route: {e}")
+        import traceback
+        traceback.print_exc()
+        raise HTTPException(status_code=500, detail=f"Internal server error: {str(e)}")
+
+    if response is None:
+        raise HTTPException(
+            status_code=400,
+            detail="No valid seating arrangement found. Possible causes: insufficient room capacity, conflicting restrictions, or timeout exceeded."
+        )
+    return Response(content=response, media_type="application/json")
+
 @router.post("/", response_model=AssignmentOut)
 def create_assignment(assignment: AssignmentIn, db: Session = Depends(get_db)):
     return assignment_service.create_assignment(db, assignment)
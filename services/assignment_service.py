@@ -1,7 +1,8 @@
 from sqlalchemy.orm import Session
 from typing import List, Optional
-from models import AssignmentIn, AssignmentOut, AssignRequest, AssignmentWithStudentOut
+from models import AssignmentIn, AssignmentOut, AssignRequest, AssignResponse, AssignmentWithStudentOut
 from datetime import date
+import asyncio
 import time
 import crud
 
@@ -30,6 +31,26 @@ except ImportError:
     NUMBA_AVAILABLE = False
     print("⚠️ Numba solver not available")
 
+try:
+    from fast_app import assign_students_native, assign_request_native, assign_response_body
+    from fast_app import assignment_table_native, ASSIGNMENT_COLUMNS, assign_request_native_async
+    NATIVE_AVAILABLE = NATIVE_MODULE_AVAILABLE = True
+    print("✅ Native C++ solver available")
+except ImportError:
+    NATIVE_AVAILABLE = NATIVE_MODULE_AVAILABLE = False
+    print("⚠️ Native C++ solver not available")
+
+# Solves go to the out-of-process solver daemon when one is running, so they
+# neither block nor can crash the API process
+try:
+    from solver_client import daemon_available, SOLVER_SOCKET
+    if daemon_available():
+        from solver_client import assign_students_native
+        NATIVE_AVAILABLE = True
+        print(f"✅ Native solver daemon available at {SOLVER_SOCKET}")
+except ImportError:
+    pass
+
 # Fallback to original solver if needed
 try:
     from app import assign_students_to_rooms
@@ -39,17 +60,48 @@ except ImportError:
     ORIGINAL_AVAILABLE = False
     print("⚠️ Original solver not available")
 
+# Wall-clock budget of one process_assignment call, fallbacks included
+ASSIGNMENT_BUDGET_SECONDS = 120
+
 def process_assignment(db: Session, request: AssignRequest, solver_preference="smart_greedy"):
     """Process assignment with best available solver - Smart Greedy prioritized"""
     try:
         print("Processing assignment request...")
         start_time = time.time()
         
+        # One budget for the whole chain: each solver gets what is left of it,
+        # up to its usual timeout, and the slow fallbacks are skipped once it
+        # is spent instead of each adding its own timeout
+        deadline = start_time + ASSIGNMENT_BUDGET_SECONDS
+        def budget(timeout_seconds):
+            return max(1, int(min(timeout_seconds, deadline - time.time())))
+        def time_left():
+            return deadline - time.time() >= 1
+        
         # Use the new StudentExamRequest model directly (all fields present)
         students = [s for s in request.students]  # Already validated Pydantic models
         room_tuples = [(room.room_id, room.rows, room.cols, room.skip_rows, room.skip_cols) 
                       for room in request.rooms]
         exam_room_restrictions = request.exam_room_restrictions or {}
+        room_layouts = {room.room_id: (room.seat_mask, room.adjacency)
+                        for room in request.rooms if room.seat_mask}
+        # Request features only the native solver honours; the other solvers
+        # would return seatings that ignore them, so there is no fallback
+        native_only = []
+        if room_layouts:
+            native_only.append("seat masks")
+        pins = request.pins or []
+        if pins:
+            native_only.append("pinned seats")
+        if native_only:
+            if not NATIVE_AVAILABLE:
+                print(f"❌ Requests with {', '.join(native_only)} need the native solver, which is not available")
+                return None
+            solver_preference = "native"
+        # Wider or diagonal separation is only understood by the greedy and native solvers
+        separation = request.separation
+        if separation is not None and solver_preference not in ("greedy", "smart_greedy", "native"):
+            solver_preference = "native" if NATIVE_AVAILABLE else "smart_greedy"
         
         print(f"Assignment request: {len(students)} students, {len(room_tuples)} rooms")
         
@@ -60,58 +112,81 @@ def process_assignment(db: Session, request: AssignRequest, solver_preference="s
         if solver_preference == "smart_greedy" and GREEDY_AVAILABLE:
             print("🧠 Using Smart Greedy solver (recommended)...")
             result = assign_students_smart_greedy(
-                students, room_tuples, exam_room_restrictions, timeout_seconds=30
+                students, room_tuples, exam_room_restrictions, timeout_seconds=budget(30), separation=separation
             )
             solver_used = "Smart Greedy"
             
         elif solver_preference == "greedy" and GREEDY_AVAILABLE:
             print("🏃‍♂️ Using basic Greedy solver...")
             result = assign_students_greedy(
-                students, room_tuples, exam_room_restrictions, timeout_seconds=30
+                students, room_tuples, exam_room_restrictions, timeout_seconds=budget(30), separation=separation
             )
             solver_used = "Greedy"
             
         elif solver_preference == "ultra_fast" and ULTRA_FAST_AVAILABLE:
             print("🚀 Using Ultra-fast CP-SAT solver...")
             result = assign_students_to_rooms_ultra_fast(
-                students, room_tuples, exam_room_restrictions, timeout_seconds=60
+                students, room_tuples, exam_room_restrictions, timeout_seconds=budget(60)
             )
             solver_used = "Ultra Fast CP-SAT"
             
         elif solver_preference == "numba" and NUMBA_AVAILABLE:
             print("⚡ Using Numba solver...")
             result = assign_students_to_rooms_numba(
-                students, room_tuples, exam_room_restrictions, timeout_seconds=90
+                students, room_tuples, exam_room_restrictions, timeout_seconds=budget(90)
             )
             solver_used = "Numba"
             
+        elif solver_preference == "native" and NATIVE_AVAILABLE:
+            print("⚙️ Using native C++ solver...")
+            result, report = assign_students_native(
+                students, room_tuples, exam_room_restrictions, timeout_seconds=budget(60),
+                room_layouts=room_layouts, separation=separation, pins=pins
+            )
+            solver_used = f"Native {report.engine} (gap {report.gap})"
+            
         # Auto mode - try best available solvers in order of preference
         elif solver_preference == "auto":
-            if GREEDY_AVAILABLE:
+            if NATIVE_AVAILABLE:
+                # Packing is near-instant; a zero gap proves no solver can use fewer rooms
+                print("⚙️ Auto mode: Trying native packing...")
+                result, report = assign_students_native(
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(60), mode="packing",
+                    room_layouts=room_layouts, separation=separation, pins=pins
+                )
+                if result and report.gap == 0:
+                    solver_used = "Native packing (Auto, proven optimal)"
+                else:
+                    result = None
+            if result is None and GREEDY_AVAILABLE:
                 print("🧠 Auto mode: Using Smart Greedy solver...")
                 result = assign_students_smart_greedy(
-                    students, room_tuples, exam_room_restrictions, timeout_seconds=30
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(30), separation=separation
                 )
                 solver_used = "Smart Greedy (Auto)"
-            elif ULTRA_FAST_AVAILABLE:
+            elif result is None and ULTRA_FAST_AVAILABLE:
                 print("🚀 Auto mode: Using Ultra-fast solver...")
                 result = assign_students_to_rooms_ultra_fast(
-                    students, room_tuples, exam_room_restrictions, timeout_seconds=60
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(60)
                 )
                 solver_used = "Ultra Fast CP-SAT (Auto)"
-            elif NUMBA_AVAILABLE:
+            elif result is None and NUMBA_AVAILABLE:
                 print("⚡ Auto mode: Using Numba solver...")
                 result = assign_students_to_rooms_numba(
-                    students, room_tuples, exam_room_restrictions, timeout_seconds=90
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(90)
                 )
                 solver_used = "Numba (Auto)"
-            elif ORIGINAL_AVAILABLE:
+            elif result is None and ORIGINAL_AVAILABLE:
                 print("🐍 Auto mode: Using original solver...")
                 result = assign_students_to_rooms(
-                    students, room_tuples, exam_room_restrictions, timeout_seconds=180
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(180)
                 )
                 solver_used = "Original CP-SAT (Auto)"
         
+        if not result and native_only:
+            print(f"❌ Native solver found no seating, and no other solver honours {', '.join(native_only)}")
+            return None
+        
         # Fallback chain if preferred solver failed or unavailable
         if not result:
             print("Primary solver failed or unavailable, trying fallbacks...")
@@ -120,16 +195,19 @@ def process_assignment(db: Session, request: AssignRequest, solver_preference="s
             if GREEDY_AVAILABLE and solver_preference != "smart_greedy":
                 print("🧠 Fallback: Trying Smart Greedy solver...")
                 result = assign_students_smart_greedy(
-                    students, room_tuples, exam_room_restrictions, timeout_seconds=30
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(30), separation=separation
                 )
                 if result:
                     solver_used = "Smart Greedy (Fallback)"
             
+            # The CP-SAT fallbacks only keep left/right/front/back apart, so
+            # they cannot serve a request with its own separation policy
+            
             # Try Ultra Fast CP-SAT
-            if not result and ULTRA_FAST_AVAILABLE and solver_preference != "ultra_fast":
+            if not result and ULTRA_FAST_AVAILABLE and solver_preference != "ultra_fast" and separation is None and time_left():
                 print("🚀 Fallback: Trying Ultra-fast solver...")
                 result = assign_students_to_rooms_ultra_fast(
-                    students, room_tuples, exam_room_restrictions, timeout_seconds=60
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(60)
                 )
                 if result:
                     solver_used = "Ultra Fast CP-SAT (Fallback)"
@@ -138,16 +216,16 @@ def process_assignment(db: Session, request: AssignRequest, solver_preference="s
             if not result and GREEDY_AVAILABLE and solver_preference != "greedy":
                 print("🏃‍♂️ Fallback: Trying basic Greedy solver...")
                 result = assign_students_greedy(
-                    students, room_tuples, exam_room_restrictions, timeout_seconds=30
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(30), separation=separation
                 )
                 if result:
                     solver_used = "Greedy (Fallback)"
             
             # Try original solver as last resort
-            if not result and ORIGINAL_AVAILABLE:
+            if not result and ORIGINAL_AVAILABLE and separation is None and time_left():
                 print("🐍 Last resort: Using original solver...")
                 result = assign_students_to_rooms(
-                    students, room_tuples, exam_room_restrictions, timeout_seconds=120
+                    students, room_tuples, exam_room_restrictions, timeout_seconds=budget(120)
                 )
                 if result:
                     solver_used = "Original CP-SAT (Last Resort)"
@@ -179,6 +257,64 @@ def process_assignment(db: Session, request: AssignRequest, solver_preference="s
         traceback.print_exc()
         return None
 
+def process_assignment_body(db: Session, body: bytes, persist: bool = False):
+    """
+    Same as process_assignment, from the raw request body to the AssignResponse
+    JSON body (bytes), None if no seating was found. With the native module the
+    request is parsed, solved and the response written in C++, without any
+    per-student Python objects; otherwise (including when only the solver
+    daemon is available) it falls back to the model path.
+    persist also stores the seating in the assignments table, dated by each
+    student's examination_date, in one bulk load.
+    Raises ValueError for a malformed body.
+    """
+    if not NATIVE_MODULE_AVAILABLE:
+        assignments = process_assignment(db, AssignRequest.parse_raw(body))
+        if not assignments:
+            return None
+        if persist:
+            table = crud.assignments_csv((a.file_number, a.room_id, a.course_code, a.row, a.col, a.examination_date)
+                                         for a in assignments)
+            count = crud.bulk_create_assignments(db, table, "csv")
+            print(f"   - Persisted {count} assignments")
+        return AssignResponse(assignments=assignments).json().encode("utf-8")
+
+    start_time = time.time()
+    request, report = assign_request_native(body)
+    return _finish_body(db, request, report, persist, start_time)
+
+async def process_assignment_body_async(db: Session, body: bytes, persist: bool = False):
+    """
+    process_assignment_body for async routes. The native solve is awaited on
+    the event loop instead of holding a threadpool worker while it runs; only
+    the response body and the bulk load go to a worker thread afterwards.
+    Without the native module the whole call runs on a worker thread.
+    """
+    if not NATIVE_MODULE_AVAILABLE:
+        return await asyncio.to_thread(process_assignment_body, db, body, persist)
+
+    start_time = time.time()
+    request, report = await assign_request_native_async(body)
+    return await asyncio.to_thread(_finish_body, db, request, report, persist, start_time)
+
+def _finish_body(db: Session, request, report, persist: bool, start_time: float):
+    """Response body of a native raw-body solve, persisting it if asked"""
+    if not report.valid or report.rooms_used == 0:
+        print(f"❌ Native solver found no valid seating ({report.status})")
+        return None
+
+    response = assign_response_body(request, report)
+    if persist:
+        persist_start = time.time()
+        table = assignment_table_native(request, report)
+        count = crud.bulk_create_assignments(db, table, "copy", ASSIGNMENT_COLUMNS)
+        print(f"   - Persisted {count} assignments in {time.time() - persist_start:.2f}s")
+    total_time = time.time() - start_time
+    print(f"✅ Assignment completed using Native {report.engine} (gap {report.gap}) from the raw body")
+    print(f"   - Total time: {total_time:.2f}s")
+    print(f"   - Response: {len(response)} bytes for {request.num_students} students")
+    return response
+
 def get_assignments(db: Session, skip: int = 0, limit: int = 100):
     db_assignments = crud.get_assignments(db, skip, limit)
     return [AssignmentOut(
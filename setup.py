@@ -1,5 +1,8 @@
 from pybind11.setup_helpers import Pybind11Extension, build_ext
-from setuptools import setup, Extension
+from setuptools import setup, Extension, Command
+import os
+import subprocess
+import sys
 import pybind11
 
 # You need to find your OR-Tools installation path
@@ -22,10 +25,57 @@ ext_modules = [
     ),
 ]
 
+def ortools_locations():
+    """
+    (include_dir, library_dir) of OR-Tools for the daemon build: ORTOOLS_ROOT,
+    an OR-Tools C++ release with include/ and lib/, when set; else the
+    installed ortools package, searched like find_ortools.py does
+    """
+    root = os.environ.get("ORTOOLS_ROOT")
+    if root:
+        return os.path.join(root, "include"), os.path.join(root, "lib")
+    try:
+        import ortools
+    except ImportError:
+        raise RuntimeError("Set ORTOOLS_ROOT to an OR-Tools C++ release or install the ortools package")
+    package = os.path.dirname(ortools.__file__)
+    candidates = [os.path.join(package, *[".."] * up, "include") for up in range(4)]
+    candidates.append(os.path.join(sys.prefix, "include"))
+    for include in candidates:
+        if os.path.exists(os.path.join(include, "ortools", "sat", "cp_model.h")):
+            return os.path.normpath(include), os.path.join(package, ".libs")
+    raise RuntimeError(f"No OR-Tools headers found next to {package}; set ORTOOLS_ROOT to an OR-Tools C++ release")
+
+class build_daemon(Command):
+    """Out-of-process solver (cpp_solver/daemon.cpp): [ORTOOLS_ROOT=...] python setup.py build_daemon"""
+    description = "build the fast_solver_daemon executable (POSIX only)"
+    user_options = []
+
+    def initialize_options(self):
+        pass
+
+    def finalize_options(self):
+        pass
+
+    def run(self):
+        if os.name != "posix":
+            raise RuntimeError("The solver daemon needs Unix domain sockets and POSIX shared memory")
+        include_dir, library_dir = ortools_locations()
+        command = [
+            os.environ.get("CXX", "c++"), "-std=c++17", "-O2", "-pthread",
+            "cpp_solver/daemon.cpp", "-o", "fast_solver_daemon",
+            "-I" + include_dir,
+            "-L" + library_dir, "-Wl,-rpath," + library_dir, "-lortools",
+        ]
+        if sys.platform.startswith("linux"):
+            command.append("-lrt")
+        print(" ".join(command))
+        subprocess.check_call(command)
+
 setup(
     name="fast_solver",
     ext_modules=ext_modules,
-    cmdclass={"build_ext": build_ext},
+    cmdclass={"build_ext": build_ext, "build_daemon": build_daemon},
     zip_safe=False,
     python_requires=">=3.8",
 )
\ No newline at end of file
@@ -7,36 +7,36 @@ import time
 from collections import defaultdict
 import random
 from models import AssignmentWithStudentOut
+from room_layout import room_positions, separation_offsets, stencil_shifts, shift_mask
 
-def assign_students_greedy(students, rooms, exam_room_restrictions=None, timeout_seconds=60):
+def assign_students_greedy(students, rooms, exam_room_restrictions=None, timeout_seconds=60, separation=None):
     """
     Simple greedy assignment algorithm
     Returns a list of AssignmentWithStudentOut objects with full student info.
+    separation is the neighbour rule (see room_layout.separation_offsets),
+    None for left/right/front/back.
     """
     print(f"🏃‍♂️ Starting Greedy assignment for {len(students)} students")
     start_time = time.time()
     
     if exam_room_restrictions is None:
         exam_room_restrictions = {}
+    # Compile restrictions once: exam -> set of allowed room ids
+    allowed_rooms = compile_restrictions(exam_room_restrictions)
+    offsets = separation_offsets(separation)
 
     # Step 1: Preprocess rooms and calculate positions
     room_info = {}
     total_capacity = 0
     
     for rid, rows, cols, skip_rows, skip_cols in rooms:
-        positions = []
-        for r in range(rows):
-            if skip_rows and r % 2 != 0:
-                continue
-            for c in range(cols):
-                if isinstance(skip_cols, int) and skip_cols > 0 and c % skip_cols == 0:
-                    continue
-                positions.append((r, c))
+        positions = room_positions(rows, cols, skip_rows, skip_cols)
         room_info[rid] = {
             'positions': positions,
             'capacity': len(positions),
             'used': set(),
-            'assignments': {}
+            'assignments': {},
+            **seat_masks(rows, cols, positions, offsets)
         }
         total_capacity += len(positions)
     
@@ -48,13 +48,11 @@ def assign_students_greedy(students, rooms, exam_room_restrictions=None, timeout
 
     # Step 2: Group students by course_code (was exam)
     exam_groups = defaultdict(list)
-    student_to_exam = {}
     for s in students:
         # s is now an object or dict with named fields
         file_number = s.file_number if hasattr(s, "file_number") else s["file_number"]
         course_code = s.course_code if hasattr(s, "course_code") else s["course_code"]
         exam_groups[course_code].append(file_number)
-        student_to_exam[file_number] = course_code
 
     # Step 3: Sort exams by size (largest first for better packing)
     sorted_exams = sorted(exam_groups.items(), key=lambda x: len(x[1]), reverse=True)
@@ -68,7 +66,7 @@ def assign_students_greedy(students, rooms, exam_room_restrictions=None, timeout
         print(f"Assigning {len(exam_students)} students for {exam}")
         available_rooms = []
         for rid, info in room_info.items():
-            if exam_room_restrictions and exam in exam_room_restrictions and rid not in exam_room_restrictions[exam]:
+            if exam in allowed_rooms and rid not in allowed_rooms[exam]:
                 continue
             available_rooms.append((rid, info))
         
@@ -105,22 +103,20 @@ def assign_students_greedy(students, rooms, exam_room_restrictions=None, timeout
             assigned = False
             for room_id, room_info_dict in available_rooms:
                 available_spots = len(room_info_dict['positions']) - len(room_info_dict['used'])
-                existing_exams = set(room_info_dict['assignments'].keys())
-                existing_exam_types = set(student_to_exam[s] for s in existing_exams)
+                existing_exam_types = room_exam_counts[room_id]
                 if existing_exam_types and exam not in existing_exam_types:
                     if available_spots < MIN_GROUP_SIZE_FOR_MIX:
                         continue
                 group_assigned = 0
                 for j in range(i, len(exam_students)):
                     student = exam_students[j]
-                    position = find_valid_position(
-                        student, exam, room_id, room_info_dict, student_to_exam
-                    )
+                    position = find_valid_position(exam, room_info_dict)
                     if position:
                         row, col = position
                         assignment[student] = (room_id, row, col)
                         room_info_dict['used'].add(position)
                         room_info_dict['assignments'][student] = position
+                        occupy_seat(room_info_dict, position, exam)
                         room_exam_counts[room_id][exam] += 1
                         room_student_counts[room_id] += 1
                         group_assigned += 1
@@ -156,30 +152,59 @@ def assign_students_greedy(students, rooms, exam_room_restrictions=None, timeout
     assignment_with_student = build_assignment_with_student(assignment, students)
     return [AssignmentWithStudentOut(**a) for a in assignment_with_student]
 
-def find_valid_position(student, exam, room_id, room_info_dict, student_to_exam):
-    """Find a valid position for a student in a room"""
-    positions = room_info_dict['positions']
-    used = room_info_dict['used']
-    assignments = room_info_dict['assignments']
-    
-    # Try positions in order (could be randomized for better results)
-    for pos in positions:
-        if pos in used:
-            continue
-        
-        # Check adjacency constraints
-        if is_position_valid(pos, exam, room_info_dict, student_to_exam):
-            return pos
+def compile_restrictions(exam_room_restrictions):
+    """exam -> set of allowed room ids, so each check is a hash lookup"""
+    return {exam: set(room_ids) for exam, room_ids in (exam_room_restrictions or {}).items()}
+
+def seat_masks(rows, cols, positions, offsets):
+    """
+    Bitmasks over a room's grid, bit r * cols + c per cell. Python ints act
+    as arbitrarily wide bitsets, so a whole room is tested in a few word ops.
+    """
+    seats = 0
+    for r, c in positions:
+        seats |= 1 << (r * cols + c)
+    return {
+        'cols': cols,
+        'free_mask': seats,           # seats not taken yet
+        'exam_masks': {},             # exam -> seats taken by that exam
+        'shifts': stencil_shifts(rows, cols, offsets),
+        'offsets': offsets,
+    }
+
+def occupy_seat(room_info_dict, position, exam):
+    r, c = position
+    bit = 1 << (r * room_info_dict['cols'] + c)
+    room_info_dict['free_mask'] &= ~bit
+    exam_masks = room_info_dict['exam_masks']
+    exam_masks[exam] = exam_masks.get(exam, 0) | bit
+
+def find_valid_position(exam, room_info_dict):
+    """
+    First free position, in row-major order, with no neighbour of the same
+    exam. The neighbours of every seat of the exam are blocked at once by
+    shifting its mask by each offset of the separation stencil.
+    """
+    cols = room_info_dict['cols']
+    taken = room_info_dict['exam_masks'].get(exam, 0)
+    blocked = 0
+    if taken:
+        for shift, guard in room_info_dict['shifts']:
+            blocked |= shift_mask(taken, shift) & guard
+    candidates = room_info_dict['free_mask'] & ~blocked
+    if not candidates:
+        return None
     
-    return None
+    bit = (candidates & -candidates).bit_length() - 1
+    return divmod(bit, cols)
 
 def is_position_valid(pos, exam, room_info_dict, student_to_exam):
     """Check if position violates adjacency constraints"""
     r, c = pos
     assignments = room_info_dict['assignments']
     
-    # Check all 4 adjacent positions
-    for dr, dc in [(-1, 0), (1, 0), (0, -1), (0, 1)]:
+    # Check every neighbour under the room's separation stencil
+    for dr, dc in room_info_dict['offsets']:
         adj_pos = (r + dr, c + dc)
         
         # Check if adjacent position exists and is occupied
@@ -198,12 +223,12 @@ def is_position_valid(pos, exam, room_info_dict, student_to_exam):
     
     return True
 
-def assign_students_smart_greedy(students, rooms, exam_room_restrictions=None, timeout_seconds=60):
+def assign_students_smart_greedy(students, rooms, exam_room_restrictions=None, timeout_seconds=60, separation=None):
     print(f"🧠 Starting Smart Greedy assignment for {len(students)} students")
     start_time = time.time()
     
     # First try improved greedy
-    assignment_list = assign_students_greedy(students, rooms, exam_room_restrictions, timeout_seconds//2)
+    assignment_list = assign_students_greedy(students, rooms, exam_room_restrictions, timeout_seconds//2, separation)
     if not assignment_list or len(assignment_list) < len(students):
         print("Improved greedy failed, returning partial result...")
         return assignment_list
@@ -215,11 +240,14 @@ def assign_students_smart_greedy(students, rooms, exam_room_restrictions=None, t
     room_analysis = analyze_room_diversity(assignment, students)
 
     print("📈 Improving assignment with diversity optimization...")
-    improved = improve_assignment_diversity(assignment, students, rooms, room_analysis, max_iterations=50)
+    offsets = separation_offsets(separation)
+    improved = improve_assignment_diversity(assignment, students, rooms, room_analysis, max_iterations=50,
+                                            offsets=offsets)
 
     if improved:
         print("🔄 Applying local search optimization...")
-        final_improved = improve_assignment_local_search(improved, students, rooms, max_iterations=50)
+        final_improved = improve_assignment_local_search(improved, students, rooms, max_iterations=50,
+                                                         offsets=offsets)
         if final_improved:
             improved = final_improved
 
@@ -278,7 +306,7 @@ def analyze_room_diversity(assignment, students):
     
     return analysis
 
-def improve_assignment_diversity(assignment, students, rooms, room_analysis, max_iterations=50):
+def improve_assignment_diversity(assignment, students, rooms, room_analysis, max_iterations=50, offsets=None):
     """Improve assignment by promoting exam diversity within rooms"""
     if not assignment:
         return None
@@ -327,7 +355,7 @@ def improve_assignment_diversity(assignment, students, rooms, room_analysis, max
                     new_assignment[single_student] = (room_id, row, col)
                     
                     # Check if swap is valid
-                    if is_assignment_valid_local(new_assignment, students):
+                    if is_assignment_valid_local(new_assignment, students, offsets):
                         current_assignment = new_assignment
                         improvements_made += 1
                         improved_this_iteration = True
@@ -350,7 +378,7 @@ def improve_assignment_diversity(assignment, students, rooms, room_analysis, max
     print(f"🎉 Diversity improvements made: {improvements_made}")
     return current_assignment if improvements_made > 0 else assignment
 
-def improve_assignment_local_search(assignment, students, rooms, max_iterations=100):
+def improve_assignment_local_search(assignment, students, rooms, max_iterations=100, offsets=None):
     """Improve assignment using local search"""
     if not assignment:
         return None
@@ -376,7 +404,7 @@ def improve_assignment_local_search(assignment, students, rooms, max_iterations=
                 new_assignment[s1], new_assignment[s2] = new_assignment[s2], new_assignment[s1]
                 
                 # Check if swap maintains validity
-                if is_assignment_valid_local(new_assignment, students):
+                if is_assignment_valid_local(new_assignment, students, offsets):
                     current_assignment = new_assignment
                     improved = True
                     break
@@ -389,8 +417,10 @@ def improve_assignment_local_search(assignment, students, rooms, max_iterations=
     
     return current_assignment
 
-def is_assignment_valid_local(assignment, students):
+def is_assignment_valid_local(assignment, students, offsets=None):
     """Quick local validity check for assignment"""
+    if offsets is None:
+        offsets = separation_offsets()
     student_to_exam = {s.file_number: s.course_code for s in students}
     # Check for adjacency violations in each room
     room_positions = defaultdict(dict)  # room_id -> {(row, col): student_id}
@@ -400,8 +430,8 @@ def is_assignment_valid_local(assignment, students):
     for room_id, pos_dict in room_positions.items():
         for (row, col), student in pos_dict.items():
             exam = student_to_exam[student]
-            # Check all 4 adjacent positions
-            for dr, dc in [(-1, 0), (1, 0), (0, -1), (0, 1)]:
+            # Check every neighbour under the separation stencil
+            for dr, dc in offsets:
                 adj_pos = (row + dr, col + dc)
                 adj_student = pos_dict.get(adj_pos)
                 if adj_student:
@@ -0,0 +1,301 @@
+"""
+Client of the native solver daemon (cpp_solver/daemon.cpp, built with
+`python setup.py build_daemon`). Solves run in that process instead of the
+API server: the instance is written column by column into a shared-memory
+segment, the daemon writes the seating back into the same segment, and only
+a short control frame crosses the Unix socket. A daemon crash surfaces as a
+failed solve here, never as a crash of the API.
+"""
+import os
+import socket
+import struct
+from array import array
+from collections import namedtuple
+from multiprocessing import shared_memory
+
+SOLVER_SOCKET = os.environ.get("FAST_SOLVER_SOCKET", "/tmp/fast_solver.sock")
+INSTANCE_MAGIC = 0x31495346  # "FSI1"
+# Seconds past timeout_seconds to wait for a solve reply before giving up on
+# the daemon; its deadline already covers the whole solve
+REPLY_MARGIN_SECONDS = 10
+
+Assignment = namedtuple("Assignment", "student_id room_id row col")
+
+
+class SolverDaemonError(ConnectionError):
+    """The daemon is unreachable, hung up mid-job or rejected the job"""
+
+
+class DaemonSolveResult:
+    """The fields of fast_solver.SolveResult, as reported by the daemon"""
+    def __init__(self, **fields):
+        self.assignments = []
+        self.status = "unknown"
+        self.engine = "daemon"
+        self.formulation = ""
+        self.rooms_used = 0
+        self.lower_bound = 0
+        self.gap = 0
+        self.valid = False
+        self.solve_ms = 0
+        self.model_variables = 0
+        self.peak_rss_mb = 0.0
+        self.seed = 0
+        self.exam_rooms = 0
+        self.max_fill_percent = 0
+        self.cached = False
+        self.instance_key = ""
+        self.__dict__.update(fields)
+
+
+class _Writer:
+    """ByteWriter layout: host-order fixed-width values, uint32-prefixed strings"""
+    def __init__(self):
+        self.parts = []
+
+    def put(self, fmt, *values):
+        self.parts.append(struct.pack("=" + fmt, *values))
+
+    def put_str(self, text):
+        data = text.encode("utf-8")
+        self.parts.append(struct.pack("=I", len(data)))
+        self.parts.append(data)
+
+    def put_array(self, typecode, values):
+        self.parts.append(array(typecode, values).tobytes())
+
+    def bytes(self):
+        return b"".join(self.parts)
+
+
+class _Reader:
+    def __init__(self, data):
+        self.data = data
+        self.at = 0
+
+    def get(self, fmt):
+        values = struct.unpack_from("=" + fmt, self.data, self.at)
+        self.at += struct.calcsize("=" + fmt)
+        return values[0] if len(values) == 1 else values
+
+    def get_str(self):
+        size = self.get("I")
+        text = bytes(self.data[self.at:self.at + size]).decode("utf-8")
+        self.at += size
+        return text
+
+
+def _call(frame, path=SOLVER_SOCKET, timeout=None):
+    """Send one frame and return the reply after its error string"""
+    try:
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as connection:
+            connection.settimeout(timeout)
+            connection.connect(path)
+            connection.sendall(struct.pack("=I", len(frame)) + frame)
+            size = struct.unpack("=I", _receive(connection, 4))[0]
+            reply = _Reader(_receive(connection, size))
+    except OSError as e:
+        raise SolverDaemonError(f"Solver daemon at {path}: {e}") from e
+    error = reply.get_str()
+    if error:
+        raise SolverDaemonError(f"Solver daemon rejected the job: {error}")
+    return reply
+
+
+def _receive(connection, size):
+    chunks = []
+    while size > 0:
+        chunk = connection.recv(min(size, 1 << 16))
+        if not chunk:
+            raise ConnectionResetError("daemon hung up")
+        chunks.append(chunk)
+        size -= len(chunk)
+    return b"".join(chunks)
+
+
+def daemon_available(path=SOLVER_SOCKET):
+    """True if a daemon answers on path"""
+    if not os.path.exists(path):
+        return False
+    frame = _Writer()
+    frame.put_str("ping")
+    try:
+        return _call(frame.bytes(), path, timeout=2).get_str() == "pong"
+    except SolverDaemonError:
+        return False
+
+
+def daemon_stats(path=SOLVER_SOCKET):
+    """Jobs served, solution cache and task pool counters of the daemon"""
+    frame = _Writer()
+    frame.put_str("stats")
+    reply = _call(frame.bytes(), path, timeout=2)
+    names = ("jobs", "entries", "warm_entries", "hits", "misses", "threads", "queued", "steals")
+    return {name: reply.get("q") for name in names}
+
+
+def _instance(students, rooms, restrictions, pins):
+    """Instance columns in the layout read_instance expects"""
+    out = _Writer()
+    exams = {}
+    file_numbers, exam_index = [], []
+    for file_number, exam in students:
+        file_numbers.append(int(file_number))
+        exam_index.append(exams.setdefault(exam, len(exams)))
+    out.put("II", INSTANCE_MAGIC, len(file_numbers))
+    out.put_array("i", file_numbers)
+    out.put_array("I", exam_index)
+    out.put("I", len(exams))
+    for exam in exams:
+        out.put_str(exam)
+
+    out.put("I", len(rooms))
+    for room_id, rows, cols, skip_rows, skip_cols, seat_mask, adjacency in rooms:
+        out.put_str(room_id)
+        out.put("iiBi", int(rows), int(cols), 1 if skip_rows else 0, int(skip_cols))
+        out.put("I", len(seat_mask))
+        for line in seat_mask:
+            out.put_str(line)
+        out.put("I", len(adjacency))
+        out.put_array("i", [int(v) for pair in adjacency for v in pair])
+
+    out.put("I", len(restrictions))
+    for exam, room_ids in restrictions.items():
+        out.put_str(exam)
+        out.put("I", len(room_ids))
+        for room_id in room_ids:
+            out.put_str(room_id)
+
+    out.put("I", len(pins))
+    for student_id, room_id, row, col in pins:
+        out.put("i", int(student_id))
+        out.put_str(room_id)
+        out.put("ii", int(row), int(col))
+    return out.bytes()
+
+
+def solve(students, rooms, restrictions=None, path=SOLVER_SOCKET, timeout_seconds=120, mode="auto",
+          accept_gap=0, formulation="auto", greedy_starts=1, seed=0, num_threads=0, memory_limit_mb=0,
+          separation=None, spread_weight=0, balance_weight=0, separation_mode="eager", decompose=True,
+          use_cache=True, pins=()):
+    """
+    Solve on the daemon. students are (file_number, exam) pairs; rooms are
+    (room_id, rows, cols, skip_rows, skip_cols, seat_mask, adjacency) with an
+    empty seat_mask for plain grids; separation is (kind, radius, offsets);
+    pins are (student_id, room_id, row, col), row = col = -1 for a room pin.
+    Returns a DaemonSolveResult; raises SolverDaemonError if the daemon fails
+    or has not replied REPLY_MARGIN_SECONDS after timeout_seconds.
+    """
+    students = list(students)
+    instance = _instance(students, rooms, restrictions or {}, list(pins))
+    solution_offset = (len(instance) + 7) // 8 * 8
+    segment = shared_memory.SharedMemory(create=True, size=max(solution_offset + 12 * len(students), 1))
+    try:
+        segment.buf[:len(instance)] = instance
+
+        kind, radius, offsets = separation or ("von_neumann", 1, [])
+        frame = _Writer()
+        frame.put_str("solve")
+        frame.put_str("/" + segment.name.lstrip("/"))
+        frame.put("QQ", segment.size, solution_offset)
+        frame.put_str(mode)
+        frame.put("ii", int(timeout_seconds), int(accept_gap))
+        frame.put_str(formulation)
+        frame.put("iQii", int(greedy_starts), int(seed), int(num_threads), int(memory_limit_mb))
+        frame.put_str(kind)
+        frame.put("iI", int(radius), len(offsets))
+        frame.put_array("i", [int(v) for offset in offsets for v in offset])
+        frame.put("ii", int(spread_weight), int(balance_weight))
+        frame.put_str(separation_mode)
+        frame.put("BB", 1 if decompose else 0, 1 if use_cache else 0)
+
+        reply = _call(frame.bytes(), path, timeout=max(0, timeout_seconds) + REPLY_MARGIN_SECONDS)
+        result = DaemonSolveResult(
+            status=reply.get_str(), engine=reply.get_str(), formulation=reply.get_str(),
+            rooms_used=reply.get("i"), lower_bound=reply.get("i"), gap=reply.get("i"),
+            valid=bool(reply.get("B")), solve_ms=reply.get("q"), model_variables=reply.get("q"),
+            peak_rss_mb=reply.get("d"), seed=reply.get("Q"), exam_rooms=reply.get("i"),
+            max_fill_percent=reply.get("i"), cached=bool(reply.get("B")), instance_key=reply.get_str(),
+        )
+
+        n = len(students)
+        columns = array("i")
+        columns.frombytes(bytes(segment.buf[solution_offset:solution_offset + 12 * n]))
+        room_ids = [room[0] for room in rooms]
+        result.assignments = [
+            Assignment(students[i][0], room_ids[columns[i]], columns[n + i], columns[2 * n + i])
+            for i in range(n) if columns[i] >= 0
+        ]
+        return result
+    finally:
+        segment.close()
+        segment.unlink()
+
+
+def assign_students_native(students, rooms, exam_room_restrictions=None, timeout_seconds=120, mode="auto",
+                           on_progress=None, accept_gap=0, memory_limit_mb=0, room_layouts=None,
+                           separation=None, greedy_starts=1, seed=0, spread_weight=0, balance_weight=0,
+                           use_cache=True, separation_mode="eager", pins=None):
+    """
+    fast_app.assign_students_native on the daemon, same arguments and result.
+    on_progress is not forwarded: updates stay inside the daemon. If the
+    daemon fails the result is (None, report) with report.valid False, so
+    callers fall back as they do for any other failed solve.
+    """
+    from simple_greedy_solver import build_assignment_with_student
+    from models import AssignmentWithStudentOut
+
+    native_students = []
+    for s in students:
+        file_number = s.file_number if hasattr(s, "file_number") else s["file_number"]
+        course_code = s.course_code if hasattr(s, "course_code") else s["course_code"]
+        native_students.append((file_number, course_code))
+
+    room_layouts = room_layouts or {}
+    native_rooms = []
+    for rid, R, C, skip_rows, skip_cols in rooms:
+        seat_mask, adjacency = room_layouts.get(rid, (None, None))
+        native_rooms.append((rid, R, C, skip_rows, skip_cols, seat_mask or [], adjacency or []))
+
+    native_separation = None
+    if separation is not None:
+        field = separation.get if isinstance(separation, dict) else (lambda name, default: getattr(separation, name, default))
+        radius = field("radius", 1)
+        native_separation = (field("kind", "von_neumann") or "von_neumann", 1 if radius is None else int(radius),
+                             [tuple(offset) for offset in field("offsets", None) or []])
+
+    native_pins = []
+    for pin in pins or []:
+        if isinstance(pin, (tuple, list)):
+            student_id, room_id, *seat = pin
+            row, col = seat if seat else (-1, -1)
+        else:
+            field = pin.get if isinstance(pin, dict) else (lambda name, default: getattr(pin, name, default))
+            student_id = field("student_id", None)
+            if student_id is None:
+                student_id = field("file_number", None)
+            room_id, row, col = field("room_id", None), field("row", None), field("col", None)
+        native_pins.append((student_id, room_id, -1 if row is None else row, -1 if col is None else col))
+
+    try:
+        solve_result = solve(native_students, native_rooms, exam_room_restrictions or {},
+                             timeout_seconds=timeout_seconds, mode=mode, accept_gap=accept_gap,
+                             greedy_starts=greedy_starts, seed=seed, memory_limit_mb=memory_limit_mb,
+                             separation=native_separation, spread_weight=spread_weight,
+                             balance_weight=balance_weight, separation_mode=separation_mode,
+                             use_cache=use_cache, pins=native_pins)
+    except SolverDaemonError as e:
+        print(f"Solver daemon failed: {e}")
+        return None, DaemonSolveResult(status="unknown", engine="daemon", gap=-1)
+
+    print(f"Native solver daemon: {solve_result.status} via {solve_result.engine}"
+          f"{' (cached)' if solve_result.cached else ''}, "
+          f"{solve_result.rooms_used} rooms (lower bound {solve_result.lower_bound}, gap {solve_result.gap}), "
+          f"solved in {solve_result.solve_ms} ms")
+
+    if not solve_result.valid:
+        return None, solve_result
+
+    assignment = {a.student_id: (a.room_id, a.row, a.col) for a in solve_result.assignments}
+    assignment_with_student = build_assignment_with_student(assignment, students)
+    return [AssignmentWithStudentOut(**a) for a in assignment_with_student], solve_result
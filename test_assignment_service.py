@@ -6,35 +6,37 @@ import sys
 import os
 sys.path.append(os.path.dirname(os.path.abspath(__file__)))
 
-from services.assignment_service import process_assignment
-from models import AssignRequest, StudentIn, RoomIn
+from services.assignment_service import process_assignment, NATIVE_AVAILABLE
+from models import AssignRequest, StudentExamRequest, RoomRequest
 from datetime import date
 
+def student(file_number, course_code):
+    return StudentExamRequest(
+        file_number=file_number, name=f"Student {file_number}", major="Science",
+        examination_date=date(2025, 7, 10), course_code=course_code, course_name=course_code,
+        language="EN", academic_year="2024/2025", time="09:00"
+    )
+
+def neighbour_clashes(result, offsets=((0, 1), (1, 0), (0, -1), (-1, 0))):
+    """Same-course students seated as neighbours under the given offsets"""
+    seats = {(a.room_id, a.row, a.col): a.course_code for a in result}
+    return [(seat, (seat[0], seat[1] + dr, seat[2] + dc)) for seat, course in seats.items()
+            for dr, dc in offsets if seats.get((seat[0], seat[1] + dr, seat[2] + dc)) == course]
+
 def test_assignment_service():
     """Test the assignment service with Smart Greedy solver"""
     print("🧪 Testing Assignment Service with Smart Greedy Solver")
     print("=" * 60)
     
     # Create test data
-    students = [
-        StudentIn(student_id=1, exam_name="Mathematics"),
-        StudentIn(student_id=2, exam_name="Mathematics"),
-        StudentIn(student_id=3, exam_name="Mathematics"),
-        StudentIn(student_id=4, exam_name="Mathematics"),
-        StudentIn(student_id=5, exam_name="Physics"),
-        StudentIn(student_id=6, exam_name="Physics"),
-        StudentIn(student_id=7, exam_name="Physics"),
-        StudentIn(student_id=8, exam_name="Physics"),
-        StudentIn(student_id=9, exam_name="Chemistry"),
-        StudentIn(student_id=10, exam_name="Chemistry"),
-        StudentIn(student_id=11, exam_name="Chemistry"),
-        StudentIn(student_id=12, exam_name="Chemistry"),
-    ]
+    students = [student(i, "Mathematics") for i in range(1, 5)]
+    students += [student(i, "Physics") for i in range(5, 9)]
+    students += [student(i, "Chemistry") for i in range(9, 13)]
     
     rooms = [
-        RoomIn(room_id="RoomA", rows=3, cols=4, skip_rows=False, skip_cols=True),   # 6 seats
-        RoomIn(room_id="RoomB", rows=4, cols=5, skip_rows=False, skip_cols=False), # 20 seats
-        RoomIn(room_id="RoomC", rows=3, cols=3, skip_rows=True, skip_cols=False),  # 6 seats
+        RoomRequest(room_id="RoomA", rows=3, cols=4, skip_rows=False, skip_cols=True),   # 6 seats
+        RoomRequest(room_id="RoomB", rows=4, cols=5, skip_rows=False, skip_cols=False), # 20 seats
+        RoomRequest(room_id="RoomC", rows=3, cols=3, skip_rows=True, skip_cols=False),  # 6 seats
     ]
     
     # Create assignment request
@@ -76,5 +78,112 @@ def test_assignment_service():
     print(f"\n{'='*60}")
     print("🎯 RECOMMENDATION: Use 'smart_greedy' for best performance!")
 
+def test_seat_mask_request():
+    """A seat mask is honoured by the native solver and refused without it"""
+    from room_layout import mask_positions
+    print("\n🧪 Testing a seat-mask request")
+    students = [student(i, "Mathematics" if i % 2 else "Physics") for i in range(1, 9)]
+    mask = ["####", "#..#", "####"]
+    request = AssignRequest(students=students, rooms=[
+        RoomRequest(room_id="Hall", rows=3, cols=4, skip_rows=False, skip_cols=0, seat_mask=mask),
+    ])
+    result = process_assignment(None, request)
+    if not NATIVE_AVAILABLE:
+        # Every other solver would seat students on the missing seats
+        assert result is None, "Seat-mask request must not fall back to a solver that ignores masks"
+        print("✅ Refused without the native solver")
+        return
+    
+    seats = set(mask_positions(mask))
+    assert len(result) == len(students), "All students should be seated in the hall"
+    assert all((a.row, a.col) in seats for a in result), "Nobody may sit on a missing seat"
+    assert not neighbour_clashes(result), "Same-course neighbours in the hall"
+    print("✅ Seat mask honoured")
+
+def test_separation_request():
+    """A diagonal separation policy holds in whichever solver serves it"""
+    from models import SeparationPolicy
+    from room_layout import separation_offsets
+    print("\n🧪 Testing a request with Moore separation")
+    students = [student(i, ["Mathematics", "Physics", "Chemistry"][i % 3]) for i in range(1, 19)]
+    request = AssignRequest(students=students, rooms=[
+        RoomRequest(room_id="RoomA", rows=4, cols=6, skip_rows=False, skip_cols=0),
+        RoomRequest(room_id="RoomB", rows=4, cols=6, skip_rows=False, skip_cols=0),
+    ], separation=SeparationPolicy(kind="moore", radius=1))
+    offsets = separation_offsets(request.separation)
+    for preference in ["smart_greedy", "greedy", "auto", "ultra_fast"]:
+        result = process_assignment(None, request, solver_preference=preference)
+        assert result is not None and len(result) == len(students), f"{preference}: all students should be seated"
+        assert not neighbour_clashes(result, offsets), f"{preference}: same-course students touch diagonally"
+    print("✅ Moore separation held for every preference")
+
+def test_pinned_request():
+    """Pins are honoured by the native solver and refused without it"""
+    from models import SeatPin
+    print("\n🧪 Testing a pinned request")
+    students = [student(i, "Mathematics" if i % 2 else "Physics") for i in range(1, 9)]
+    request = AssignRequest(students=students, rooms=[
+        RoomRequest(room_id="RoomA", rows=3, cols=4, skip_rows=False, skip_cols=0),
+        RoomRequest(room_id="RoomB", rows=3, cols=4, skip_rows=False, skip_cols=0),
+    ], pins=[SeatPin(file_number=1, room_id="RoomB", row=2, col=3), SeatPin(file_number=2, room_id="RoomB")])
+    result = process_assignment(None, request)
+    if not NATIVE_AVAILABLE:
+        # The other solvers would ignore the pins
+        assert result is None, "Pinned request must not fall back to a solver that ignores pins"
+        print("✅ Refused without the native solver")
+        return
+    
+    by_number = {a.file_number: a for a in result}
+    assert len(result) == len(students), "All students should be seated"
+    assert (by_number[1].room_id, by_number[1].row, by_number[1].col) == ("RoomB", 2, 3), "Seat pin ignored"
+    assert by_number[2].room_id == "RoomB", "Room pin ignored"
+    # Both pins are in RoomB and everyone fits there
+    assert {a.room_id for a in result} == {"RoomB"}, "A second room was opened beside the pinned one"
+    print("✅ Pins honoured")
+
+def test_bulk_load():
+    """Bulk-load payloads decode, and persist stores a seating in one load"""
+    import json
+    import crud
+    import models
+    from sqlalchemy import create_engine
+    from sqlalchemy.orm import sessionmaker
+    from services.assignment_service import process_assignment_body
+    print("\n🧪 Testing the bulk assignment load")
+    copy = b"1\tRoom\\\\A\tPHY\\t101\t0\t2\t2025-07-10\n2\tRoomB\tline\\nbreak\t1\t3\t2025-07-10\n"
+    assert crud._table_rows(copy, "copy") == [
+        ["1", "Room\\A", "PHY\t101", "0", "2", "2025-07-10"],
+        ["2", "RoomB", "line\nbreak", "1", "3", "2025-07-10"],
+    ], "COPY escapes should decode"
+    csv = b'1,RoomA,"Calc, I",0,2,2025-07-10\n2,RoomB,"say ""hi""",1,3,2025-07-10\n'
+    assert crud._table_rows(csv, "csv") == [
+        ["1", "RoomA", "Calc, I", "0", "2", "2025-07-10"],
+        ["2", "RoomB", 'say "hi"', "1", "3", "2025-07-10"],
+    ], "CSV quoting should decode"
+    rows = [(1, "Room A", 'Calc, "I"', 0, 2, date(2025, 7, 10)), (2, "RoomB", "PHY\t101\n", 1, 3, date(2025, 7, 11))]
+    assert crud._table_rows(crud.assignments_csv(rows), "csv") == [
+        ["1", "Room A", 'Calc, "I"', "0", "2", "2025-07-10"],
+        ["2", "RoomB", "PHY\t101\n", "1", "3", "2025-07-11"],
+    ], "Python rows should round-trip through CSV"
+    
+    # persist=True stores exactly the seating it answers with, native or not
+    engine = create_engine("sqlite://")
+    models.Base.metadata.create_all(bind=engine)
+    db = sessionmaker(bind=engine)()
+    request = AssignRequest(students=[student(i, "Mathematics" if i % 2 else "Physics") for i in range(1, 7)],
+                            rooms=[RoomRequest(room_id="RoomA", rows=3, cols=4, skip_rows=False, skip_cols=0)])
+    body = process_assignment_body(db, request.json().encode("utf-8"), persist=True)
+    assert body is not None, "The request should be seated"
+    answered = {(a["file_number"], a["room_id"], a["course_code"], a["row"], a["col"], date.fromisoformat(a["examination_date"]))
+                for a in json.loads(body)["assignments"]}
+    stored = {(a.student_id, a.room_id, a.exam_name, a.row, a.col, a.date) for a in crud.get_assignments(db)}
+    assert stored == answered and len(stored) == 6, "Stored assignments should match the response"
+    print("✅ Payloads decode and persist stores the seating")
+
 if __name__ == "__main__":
     test_assignment_service()
+    test_seat_mask_request()
+    test_separation_request()
+    test_pinned_request()
+    test_bulk_load()
+    print("\n🎉 Assignment service checks passed!")
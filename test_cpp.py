@@ -41,6 +41,19 @@ def test_cpp_solver():
             print("\nAssignments:")
             for assignment in assignments:
                 print(f"Student {assignment.student_id} -> {assignment.room_id} ({assignment.row}, {assignment.col})")
+            
+            # Every mode reports rooms used against a certified lower bound
+            from fast_solver import SolveOptions
+            for mode in ["packing", "auto"]:
+                options = SolveOptions()
+                options.mode = mode
+                options.timeout_seconds = 60
+                result = optimizer.run(cpp_students, cpp_rooms, restrictions, options)
+                print(f"{mode}: {result.status} via {result.engine}, rooms {result.rooms_used}, "
+                      f"lower bound {result.lower_bound}, gap {result.gap}, valid {result.valid}, "
+                      f"peak RSS {result.peak_rss_mb:.1f} MB")
+                if not result.valid:
+                    return False
             return True
         else:
             print("No solution found")
@@ -53,9 +66,346 @@ def test_cpp_solver():
         print(f"❌ C++ solver test failed: {e}")
         return False
 
+def test_duplicate_rooms():
+    """A request naming one room twice is rejected"""
+    try:
+        from fast_solver import FastSeatingOptimizer, Student, Room
+        
+        students = [Student(1, "Math"), Student(2, "Physics")]
+        rooms = [Room("RoomA", 2, 2, False, False), Room("RoomA", 3, 3, False, False), Room("RoomB", 2, 2, False, False)]
+        try:
+            FastSeatingOptimizer().solve(students, rooms, {"Math": ["RoomB"]}, 10)
+        except ValueError as e:
+            print(f"rejected: {e}")
+            return True
+        print("❌ Duplicate room ID accepted")
+        return False
+    except Exception as e:
+        print(f"❌ Duplicate room test failed: {e}")
+        return False
+
+def seating_errors(assignments, rooms, exam_of, offsets=((0, 1), (1, 0), (0, -1), (-1, 0))):
+    """
+    Problems with a seating: students seated twice or on a seat their room
+    does not have, and same-exam neighbours under the separation offsets.
+    rooms maps a room ID to its seat positions (room_layout.room_positions
+    or mask_positions).
+    """
+    errors = []
+    taken = {}
+    for a in assignments:
+        seat = (a.room_id, a.row, a.col)
+        if (a.row, a.col) not in rooms[a.room_id]:
+            errors.append(f"student {a.student_id} on missing seat {seat}")
+        if seat in taken:
+            errors.append(f"students {taken[seat]} and {a.student_id} share {seat}")
+        taken[seat] = a.student_id
+    for (room_id, row, col), student_id in taken.items():
+        for dr, dc in offsets:
+            other = taken.get((room_id, row + dr, col + dc))
+            if other is not None and exam_of[other] == exam_of[student_id]:
+                errors.append(f"students {student_id} and {other} of {exam_of[student_id]} are neighbours")
+    return errors
+
+def test_seat_masks():
+    """Masked rooms and skipped columns: students only on seats the room has"""
+    try:
+        from fast_solver import FastSeatingOptimizer, Student, Room, SolveOptions
+        from room_layout import room_positions, mask_positions
+        
+        exam_of = {i: ("Math" if i <= 8 else "Physics") for i in range(1, 17)}
+        mask = ["###.#", "#...#", "#####"]
+        rooms = [Room.from_mask("Hall", mask, []), Room("RoomB", 3, 5, False, 1), Room("RoomC", 3, 5, False, 3)]
+        seats = {"Hall": set(mask_positions(mask)), "RoomB": set(room_positions(3, 5, False, 1)),
+                 "RoomC": set(room_positions(3, 5, False, 3))}
+        students = [Student(i, exam) for i, exam in exam_of.items()]
+        
+        for mode in ("greedy", "auto"):
+            options = SolveOptions()
+            options.mode = mode
+            options.timeout_seconds = 30
+            result = FastSeatingOptimizer().run(students, rooms, {}, options)
+            errors = seating_errors(result.assignments, seats, exam_of)
+            print(f"{mode}: {result.status}, rooms {result.rooms_used}, valid {result.valid}")
+            if not result.valid or len(result.assignments) != len(students) or errors:
+                print("\n".join(errors))
+                return False
+        return True
+    except Exception as e:
+        print(f"❌ Seat mask test failed: {e}")
+        return False
+
+def test_cache():
+    """A resubmitted instance, students in another order, comes from the cache"""
+    try:
+        from fast_solver import FastSeatingOptimizer, Student, Room, SolveOptions, clear_cache
+        
+        clear_cache()
+        students = [Student(i, "Math" if i % 3 else "Physics") for i in range(1, 31)]
+        rooms = [Room("RoomA", 5, 6, False, 0), Room("RoomB", 4, 4, False, 1)]
+        options = SolveOptions()
+        options.timeout_seconds = 30
+        first = FastSeatingOptimizer().run(students, rooms, {}, options)
+        second = FastSeatingOptimizer().run(list(reversed(students)), rooms, {}, options)
+        seating = lambda result: {(a.student_id, a.room_id, a.row, a.col) for a in result.assignments}
+        print(f"cache: first cached={first.cached}, second cached={second.cached}, key {second.instance_key[:12]}")
+        return (not first.cached and second.cached and first.instance_key == second.instance_key
+                and seating(first) == seating(second))
+    except Exception as e:
+        print(f"❌ Cache test failed: {e}")
+        return False
+
+def test_components():
+    """Exams that share no room are solved apart without costing rooms"""
+    try:
+        from fast_solver import FastSeatingOptimizer, Student, Room, SolveOptions
+        from room_layout import room_positions
+        
+        exam_of = {i: ("Math" if i <= 20 else "Physics") for i in range(1, 33)}
+        rooms = [Room(room_id, 4, 4, False, 0) for room_id in ("RoomA", "RoomB", "RoomC", "RoomD")]
+        seats = {room_id: set(room_positions(4, 4, False, 0)) for room_id in ("RoomA", "RoomB", "RoomC", "RoomD")}
+        restrictions = {"Math": ["RoomA", "RoomB"], "Physics": ["RoomC", "RoomD"]}
+        students = [Student(i, exam) for i, exam in exam_of.items()]
+        
+        rooms_used = set()
+        for decompose in (True, False):
+            options = SolveOptions()
+            options.timeout_seconds = 30
+            options.use_cache = False
+            options.decompose = decompose
+            result = FastSeatingOptimizer().run(students, rooms, restrictions, options)
+            errors = seating_errors(result.assignments, seats, exam_of)
+            errors += [f"student {a.student_id} in restricted room {a.room_id}" for a in result.assignments
+                       if a.room_id not in restrictions[exam_of[a.student_id]]]
+            print(f"decompose={decompose}: {result.status} via {result.engine}, rooms {result.rooms_used}")
+            if not result.valid or len(result.assignments) != len(students) or errors:
+                print("\n".join(errors))
+                return False
+            rooms_used.add(result.rooms_used)
+        return len(rooms_used) == 1
+    except Exception as e:
+        print(f"❌ Component test failed: {e}")
+        return False
+
+def test_pins():
+    """Pinned seats and rooms are kept, and a room holding a pin counts as open"""
+    try:
+        from fast_solver import FastSeatingOptimizer, Student, Room, SolveOptions, Pin
+        from room_layout import room_positions, mask_positions
+        
+        exam_of = {i: ("Math" if i <= 6 else "Physics") for i in range(1, 13)}
+        mask = ["###.#", "#...#", "#####"]
+        rooms = [Room.from_mask("Hall", mask, []), Room("RoomB", 3, 4, False, 0)]
+        seats = {"Hall": set(mask_positions(mask)), "RoomB": set(room_positions(3, 4, False, 0))}
+        students = [Student(i, exam) for i, exam in exam_of.items()]
+        for decompose in (True, False):
+            options = SolveOptions()
+            options.timeout_seconds = 30
+            options.use_cache = False
+            options.decompose = decompose
+            options.pins = [Pin(1, "Hall", 2, 4), Pin(7, "RoomB")]
+            result = FastSeatingOptimizer().run(students, rooms, {}, options)
+            errors = seating_errors(result.assignments, seats, exam_of)
+            by_student = {a.student_id: a for a in result.assignments}
+            if (by_student[1].room_id, by_student[1].row, by_student[1].col) != ("Hall", 2, 4):
+                errors.append(f"pin of student 1 ignored: {by_student[1].room_id} {by_student[1].row},{by_student[1].col}")
+            if by_student[7].room_id != "RoomB":
+                errors.append(f"room pin of student 7 ignored: {by_student[7].room_id}")
+            print(f"decompose={decompose}: {result.status}, rooms {result.rooms_used}, valid {result.valid}")
+            if not result.valid or len(result.assignments) != len(students) or errors:
+                print("\n".join(errors))
+                return False
+        
+        # Everyone fits next to the pinned student: the small room alone is optimal
+        students = [Student(i, "Math" if i % 2 else "Physics") for i in range(1, 7)]
+        rooms = [Room("Big", 6, 6, False, 0), Room("Small", 3, 4, False, 0)]
+        for mode in ("packing", "greedy", "auto"):
+            options = SolveOptions()
+            options.mode = mode
+            options.use_cache = False
+            options.pins = [Pin(1, "Small", 0, 0)]
+            result = FastSeatingOptimizer().run(students, rooms, {}, options)
+            used = {a.room_id for a in result.assignments}
+            print(f"{mode}: rooms {result.rooms_used} {sorted(used)}, lower bound {result.lower_bound}")
+            if result.rooms_used != 1 or used != {"Small"} or result.lower_bound != 1:
+                return False
+        return True
+    except Exception as e:
+        print(f"❌ Pin test failed: {e}")
+        return False
+
+def request_body(students, rooms, **extra):
+    """An /assign body from (file_number, course_code) pairs and room dicts"""
+    import json
+    return json.dumps(dict(students=[
+        {"file_number": number, "name": f'Zoë "{number}"\tback\\slash', "major": "Science",
+         "examination_date": "2025-07-10", "course_code": code, "course_name": "Calculus, I",
+         "language": "EN", "academic_year": "2024/2025", "time": "09:00"} for number, code in students],
+        rooms=rooms, **extra)).encode("utf-8")
+
+def test_request_json():
+    """Raw /assign bodies parsed natively, malformed ones rejected"""
+    try:
+        from fast_solver import FastSeatingOptimizer, parse_assign_request
+        
+        students = [(i, "MTH101" if i % 2 else "PHY\t101") for i in range(1, 9)]
+        rooms = [{"room_id": "RoomA", "rows": 3, "cols": 4, "skip_rows": False, "skip_cols": 0}]
+        request = parse_assign_request(request_body(
+            students, rooms, pins=[{"file_number": 2, "room_id": "RoomA", "row": 0, "col": 0}]))
+        result = FastSeatingOptimizer().run_request(request)
+        seats = {a.student_id: (a.room_id, a.row, a.col) for a in result.assignments}
+        print(f"request json: {request.num_students} students, {result.status}")
+        if request.num_students != len(students) or len(seats) != len(students) or seats[2] != ("RoomA", 0, 0):
+            return False
+        
+        for bad in (b"{", b'{"students": [], "rooms": [{"room_id": "A"}]}', b'{"students": 3, "rooms": []}'):
+            try:
+                parse_assign_request(bad)
+                print(f"❌ Malformed body accepted: {bad!r}")
+                return False
+            except ValueError as e:
+                print(f"rejected {bad!r}: {e}")
+        return True
+    except Exception as e:
+        print(f"❌ Request JSON test failed: {e}")
+        return False
+
+def test_response_json():
+    """The natively written AssignResponse echoes every student field"""
+    try:
+        import json
+        from fast_solver import FastSeatingOptimizer, parse_assign_request, assign_response_json
+        
+        students = [(i, "MTH101" if i % 2 else "PHY\t101") for i in range(1, 9)]
+        body = request_body(students, [{"room_id": "RoomA", "rows": 3, "cols": 4, "skip_rows": False, "skip_cols": 0}])
+        sent = {s["file_number"]: s for s in json.loads(body)["students"]}
+        request = parse_assign_request(body)
+        result = FastSeatingOptimizer().run_request(request)
+        response = json.loads(assign_response_json(request, result))["assignments"]
+        seats = {a.student_id: (a.room_id, a.row, a.col) for a in result.assignments}
+        print(f"response json: {len(response)} assignments, first {response[0]}")
+        return len(response) == len(students) and all(
+            {key: a[key] for key in sent[a["file_number"]]} == sent[a["file_number"]] and
+            (a["room_id"], a["row"], a["col"]) == seats[a["file_number"]] for a in response)
+    except Exception as e:
+        print(f"❌ Response JSON test failed: {e}")
+        return False
+
+def test_assignment_table():
+    """COPY and CSV payloads decode, through crud, back to the seating"""
+    try:
+        from fast_solver import FastSeatingOptimizer, Student, Room, SolveOptions, parse_assign_request, assignment_table
+        from crud import _table_rows
+        
+        # Every awkward exam code the emitter must escape
+        codes = ["PHY\t101", "back\\slash", "comma, quote \"", "line\nbreak", "plain"]
+        students = [Student(i, code) for i, code in enumerate(codes)]
+        result = FastSeatingOptimizer().run(students, [Room("Room A", 3, 4, False, 0)], {}, SolveOptions())
+        expected = [[str(a.student_id), a.room_id, codes[a.student_id], str(a.row), str(a.col), "2025-07-10"]
+                    for a in result.assignments]
+        for table_format in ("copy", "csv"):
+            rows = _table_rows(assignment_table(students, result, "2025-07-10", table_format), table_format)
+            print(f"{table_format}: {len(rows)} rows, first {rows[0]}")
+            if rows != expected:
+                return False
+        
+        # From a raw request the rows are dated by each student's examination_date
+        request = parse_assign_request(request_body(
+            [(1, "MTH101"), (2, "PHY101")], [{"room_id": "RoomA", "rows": 2, "cols": 2, "skip_rows": False, "skip_cols": 0}]))
+        result = FastSeatingOptimizer().run_request(request)
+        rows = _table_rows(assignment_table(request, result, "", "copy"), "copy")
+        return len(rows) == 2 and all(row[5] == "2025-07-10" for row in rows)
+    except Exception as e:
+        print(f"❌ Assignment table test failed: {e}")
+        return False
+
+def test_daemon_frames():
+    """The instance layout solver_client writes is the one daemon.cpp reads"""
+    try:
+        from solver_client import _instance, _Reader, INSTANCE_MAGIC, daemon_available, solve
+        
+        students = [(1, "Math"), (2, "Physics"), (3, "Math")]
+        rooms = [("RoomA", 2, 3, False, 1, [], []), ("Hall", 0, 0, False, 0, ["##.", "###"], [(0, 4)])]
+        restrictions = {"Physics": ["RoomA"]}
+        pins = [(3, "Hall", 1, 2)]
+        data = _Reader(_instance(students, rooms, restrictions, pins))
+        
+        # Field by field, in the order of daemon.cpp read_instance
+        checks = [data.get("I") == INSTANCE_MAGIC, data.get("I") == 3, data.get("3i") == (1, 2, 3),
+                  data.get("3I") == (0, 1, 0), data.get("I") == 2, data.get_str() == "Math", data.get_str() == "Physics",
+                  data.get("I") == 2,
+                  data.get_str() == "RoomA", data.get("iiBi") == (2, 3, 0, 1), data.get("I") == 0, data.get("I") == 0,
+                  data.get_str() == "Hall", data.get("iiBi") == (0, 0, 0, 0), data.get("I") == 2,
+                  data.get_str() == "##.", data.get_str() == "###", data.get("I") == 1, data.get("2i") == (0, 4),
+                  data.get("I") == 1, data.get_str() == "Physics", data.get("I") == 1, data.get_str() == "RoomA",
+                  data.get("I") == 1, data.get("i") == 3, data.get_str() == "Hall", data.get("ii") == (1, 2),
+                  data.at == len(data.data)]
+        if not all(checks):
+            print(f"❌ Instance layout differs at field {checks.index(False)}")
+            return False
+        
+        if daemon_available():
+            result = solve(students, rooms, restrictions, timeout_seconds=10, pins=pins)
+            seats = {a.student_id: (a.room_id, a.row, a.col) for a in result.assignments}
+            print(f"daemon: {result.status}, seats {seats}")
+            return result.valid and seats[3] == ("Hall", 1, 2) and seats[2][0] == "RoomA"
+        print("daemon: not running, layout checked only")
+        return True
+    except Exception as e:
+        print(f"❌ Daemon frame test failed: {e}")
+        return False
+
+def test_async_solve():
+    """Awaited native solves: result, ValueError from the await, and cancellation"""
+    try:
+        import asyncio
+        from fast_app import assign_request_native_async
+        
+        def body(count):
+            return request_body([(i, f"C{i % 7}") for i in range(count)],
+                                [{"room_id": f"R{k}", "rows": 20, "cols": 20, "skip_rows": False, "skip_cols": 0}
+                                 for k in range(count // 150 + 2)])
+        
+        async def run():
+            request, result = await assign_request_native_async(body(40), timeout_seconds=30)
+            if not result.valid or request.num_students != 40:
+                return False
+            try:
+                await assign_request_native_async(b"not json")
+                return False
+            except ValueError:
+                pass
+            # A long CP-SAT solve, cancelled: the await ends at once
+            task = asyncio.ensure_future(assign_request_native_async(body(3000), timeout_seconds=60, mode="cpsat"))
+            await asyncio.sleep(0.5)
+            start = time.time()
+            task.cancel()
+            try:
+                await task
+                return False
+            except asyncio.CancelledError:
+                print(f"async: cancelled after {time.time() - start:.3f}s")
+            # Let the stopped solve hand its result to a loop that is still open
+            await asyncio.sleep(1)
+            return True
+        
+        return asyncio.run(run())
+    except Exception as e:
+        print(f"❌ Async solve test failed: {e}")
+        return False
+
 if __name__ == "__main__":
     success = test_cpp_solver()
     if success:
         print("🎉 C++ solver test passed!")
     else:
-        print("💥 C++ solver test failed!")
\ No newline at end of file
+        print("💥 C++ solver test failed!")
+    
+    for test in (test_duplicate_rooms, test_seat_masks, test_cache, test_components, test_pins, test_request_json, test_response_json, test_assignment_table, test_daemon_frames, test_async_solve):
+        print(f"\n{'='*20} {test.__doc__} {'='*20}")
+        passed = test()
+        success = success and passed
+        print(f"{'✅' if passed else '💥'} {test.__name__} {'passed' if passed else 'failed'}")
+    
+    if not success:
+        raise SystemExit(1)
@@ -67,3 +67,39 @@ assert len(assignments) == len(students), "All students should be assigned"
 assigned_file_numbers = {a.file_number for a in assignments}
 assert assigned_file_numbers == {1, 2, 3, 4}, "All file_numbers should be present"
 print("\nTest passed!")
+
+# Column skipping: 1 and 2 both skip the odd columns, k skips c % k == k - 1
+from room_layout import column_skipped, room_positions
+assert [c for c in range(6) if column_skipped(c, 1)] == [1, 3, 5], "skip_cols=1 should skip the odd columns"
+assert room_positions(2, 6, False, 1) == room_positions(2, 6, False, 2), "skip_cols 1 and 2 should agree"
+assert [c for c in range(6) if column_skipped(c, 3)] == [2, 5], "skip_cols=3 should skip every third column"
+assert not any(column_skipped(c, 0) for c in range(6)), "skip_cols=0 should skip nothing"
+
+# skip_cols >= 2 used to skip the columns with c % k == 0 in the greedy and
+# original CP-SAT solvers (and the Numba positions). Seats under the old and
+# the current rule, for rooms stored with those values:
+legacy_columns = lambda cols, k: [c for c in range(cols) if c % k != 0]
+for k, cols, before, now in ((2, 5, [1, 3], [0, 2, 4]), (3, 7, [1, 2, 4, 5], [0, 1, 3, 4, 6])):
+    assert legacy_columns(cols, k) == before
+    assert [c for r, c in room_positions(1, cols, False, k)] == now, f"skip_cols={k} seats changed again"
+print("Column skipping passed!")
+
+# Moore separation: no same-course students on diagonals either
+from models import StudentExamRequest
+from simple_greedy_solver import assign_students_smart_greedy
+
+moore_students = [dict(students[i % 4], file_number=10 + i) for i in range(12)]
+moore_rooms = [("RoomM", 4, 6, False, 0)]
+
+def same_course_neighbours(seated):
+    seats = {(a.room_id, a.row, a.col): a.course_code for a in seated}
+    return [(room, r, c) for (room, r, c), code in seats.items()
+            for dr, dc in ((1, -1), (1, 0), (1, 1), (0, 1))
+            if seats.get((room, r + dr, c + dc)) == code]
+
+for solver, batch in ((assign_students_greedy, moore_students),
+                      (assign_students_smart_greedy, [StudentExamRequest(**s) for s in moore_students])):
+    seated = solver(batch, moore_rooms, separation={"kind": "moore"})
+    assert seated and len(seated) == len(moore_students), f"{solver.__name__} should seat everyone"
+    assert not same_course_neighbours(seated), f"{solver.__name__} broke Moore separation"
+print("Moore separation passed!")
@@ -1,6 +1,7 @@
 import numpy as np
 from ortools.sat.python import cp_model
 import time
+from room_layout import column_skipped
 
 def assign_students_to_rooms_ultra_fast(students, rooms, exam_room_restrictions=None, timeout_seconds=60):
     """Ultra-optimized Python version - 10-20x faster than original"""
@@ -10,6 +11,8 @@ def assign_students_to_rooms_ultra_fast(students, rooms, exam_room_restrictions=
     
     if exam_room_restrictions is None:
         exam_room_restrictions = {}
+    # Compile restrictions once so each check is a set lookup
+    exam_room_restrictions = {exam: set(rids) for exam, rids in exam_room_restrictions.items()}
 
     # OPTIMIZATION 1: Pre-process all data
     exam_to_students = {}
@@ -32,7 +35,7 @@ def assign_students_to_rooms_ultra_fast(students, rooms, exam_room_restrictions=
             if skip_rows and r % 2 != 0:
                 continue
             for c in range(C):
-                if skip_cols and c % 2 != 0:
+                if column_skipped(c, skip_cols):
                     continue
                 positions.append((r, c))
         
@@ -235,7 +238,7 @@ def visualize_assignment(assignment, rooms, students):
             # Mark unavailable seats
             for r in range(rows):
                 for c in range(cols):
-                    if (skip_rows and r % 2 != 0) or (skip_cols and c % 2 != 0):
+                    if (skip_rows and r % 2 != 0) or column_skipped(c, skip_cols):
                         grid[r][c] = 'X'
             
             # Place students